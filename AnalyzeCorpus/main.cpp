@@ -0,0 +1,10 @@
+/* The analyze-corpus program, built on its own from this directory
+ * together with the sources of Musical Modulations, with both
+ * directories on the include path. See corpusAnalyzerMain for its
+ * arguments.
+ */
+#include "corpusanalyzer.h"
+
+int main(int argc, char* argv[]) {
+    return corpusAnalyzerMain(argc, argv);
+}
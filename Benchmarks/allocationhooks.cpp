@@ -0,0 +1,83 @@
+#include "benchmark.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/* Replacements for the global operator new and delete that count every
+ * allocation and track the bytes live and their peak. The array and
+ * nothrow forms forward to these by default. Each block carries its
+ * size in a header in front of it, padded to the block's alignment so
+ * the caller's pointer stays aligned.
+ */
+
+static atomic<long long> allocations(0);
+static atomic<long long> liveBytes(0);
+static atomic<long long> peakBytes(0);
+static long long baselineBytes = 0;
+
+static const size_t HEADER_BYTES = alignof(max_align_t);
+
+static void* allocate(size_t bytes, size_t alignment) {
+    size_t header = alignment > HEADER_BYTES ? alignment : HEADER_BYTES;
+    size_t total = (header + bytes + alignment - 1) / alignment * alignment;
+    char* base = static_cast<char*>(aligned_alloc(alignment, total));
+    if (base == nullptr) {
+        throw bad_alloc();
+    }
+    reinterpret_cast<size_t*>(base + header)[-1] = bytes;
+    allocations++;
+    long long live = liveBytes += bytes;
+    for (long long peak = peakBytes; live > peak && !peakBytes.compare_exchange_weak(peak, live);) {
+    }
+    return base + header;
+}
+
+static void deallocate(void* pointer, size_t alignment) {
+    if (pointer == nullptr) {
+        return;
+    }
+    size_t header = alignment > HEADER_BYTES ? alignment : HEADER_BYTES;
+    char* block = static_cast<char*>(pointer);
+    liveBytes -= reinterpret_cast<size_t*>(block)[-1];
+    free(block - header);
+}
+
+void* operator new(size_t bytes) {
+    return allocate(bytes, HEADER_BYTES);
+}
+
+void* operator new(size_t bytes, align_val_t alignment) {
+    return allocate(bytes, size_t(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+    deallocate(pointer, HEADER_BYTES);
+}
+
+void operator delete(void* pointer, align_val_t alignment) noexcept {
+    deallocate(pointer, size_t(alignment));
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    deallocate(pointer, HEADER_BYTES);
+}
+
+void operator delete(void* pointer, size_t, align_val_t alignment) noexcept {
+    deallocate(pointer, size_t(alignment));
+}
+
+void resetAllocationCounters() {
+    allocations = 0;
+    baselineBytes = liveBytes;
+    peakBytes = baselineBytes;
+}
+
+long long allocationCount() {
+    return allocations;
+}
+
+long long peakAllocatedBytes() {
+    return peakBytes - baselineBytes;
+}
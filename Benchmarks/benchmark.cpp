@@ -0,0 +1,331 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "error.h"
+#include "map.h"
+
+using namespace std;
+
+/* A change in time smaller than this is scheduling and cache noise on a
+ * shared machine, not a regression, whatever its ratio to the baseline.
+ */
+static const double NOISE_SECONDS = 5e-3;
+
+/* Runs a case repeats times and reports the median time, which one
+ * slow or one lucky run cannot move the way it moves the mean or the
+ * minimum. The allocation counters are reset before each run, and a run
+ * whose answer differs from the first is an error, since the inputs are
+ * fixed.
+ */
+BenchmarkResult runBenchmark(const BenchmarkCase& benchmark, int repeats) {
+    BenchmarkResult result;
+    result.suite = benchmark.suite;
+    result.name = benchmark.name;
+    result.parameters = benchmark.parameters;
+    result.size = benchmark.size;
+    Vector<double> times;
+    for (int repeat = 0; repeat < max(repeats, 1); repeat++) {
+        Probe probe;
+        resetAllocationCounters();
+        auto begin = chrono::steady_clock::now();
+        long long answer = benchmark.run(probe);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        if (repeat > 0 && answer != result.answer) {
+            error("runBenchmark: " + benchmark.name + " " + benchmark.parameters + " answered " +
+                  to_string(answer) + " after " + to_string(result.answer));
+        }
+        times.add(seconds);
+        result.work = benchmark.countsWork ? probe.work : -1;
+        result.allocations = allocationCount();
+        result.peakBytes = peakAllocatedBytes();
+        result.answer = answer;
+    }
+    sort(times.begin(), times.end());
+    int middle = times.size() / 2;
+    result.seconds = times.size() % 2 == 1 ? times[middle] : (times[middle - 1] + times[middle]) / 2;
+    return result;
+}
+
+static const string CSV_HEADER = "suite,name,parameters,size,seconds,work,allocations,peak_bytes,answer";
+
+/* The work column, empty for a case that counts none. */
+static string workField(const BenchmarkResult& result, const string& empty) {
+    return result.work < 0 ? empty : to_string(result.work);
+}
+
+void writeResultsCsv(const Vector<BenchmarkResult>& results, const string& path) {
+    ofstream out(path);
+    if (!out) {
+        error("writeResultsCsv: cannot write " + path);
+    }
+    out << CSV_HEADER << "\n";
+    for (const BenchmarkResult& result : results) {
+        char seconds[32];
+        snprintf(seconds, sizeof(seconds), "%.9f", result.seconds);
+        out << result.suite << "," << result.name << "," << result.parameters << "," << result.size << ","
+            << seconds << "," << workField(result, "") << "," << result.allocations << "," << result.peakBytes << ","
+            << result.answer << "\n";
+    }
+}
+
+/* Names and parameters are plain words and numbers, so the only
+ * characters that need escaping are ones they never contain; quotes and
+ * backslashes are escaped anyway.
+ */
+static string jsonString(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+void writeResultsJson(const Vector<BenchmarkResult>& results, const string& path) {
+    ofstream out(path);
+    if (!out) {
+        error("writeResultsJson: cannot write " + path);
+    }
+    out << "[\n";
+    for (int i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        char seconds[32];
+        snprintf(seconds, sizeof(seconds), "%.9f", result.seconds);
+        out << "  {\"suite\": " << jsonString(result.suite) << ", \"name\": " << jsonString(result.name)
+            << ", \"parameters\": " << jsonString(result.parameters) << ", \"size\": " << result.size
+            << ", \"seconds\": " << seconds << ", \"work\": " << workField(result, "null")
+            << ", \"allocations\": " << result.allocations << ", \"peak_bytes\": " << result.peakBytes
+            << ", \"answer\": " << result.answer << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+/* Reads results written by writeResultsCsv, to use as a baseline. */
+Vector<BenchmarkResult> readResultsCsv(const string& path) {
+    ifstream in(path);
+    if (!in) {
+        error("readResultsCsv: cannot open " + path);
+    }
+    string line;
+    if (!getline(in, line) || line != CSV_HEADER) {
+        error("readResultsCsv: " + path + " does not start with the header " + CSV_HEADER);
+    }
+    Vector<BenchmarkResult> results;
+    for (int number = 2; getline(in, line); number++) {
+        if (line.empty()) {
+            continue;
+        }
+        istringstream fields(line);
+        BenchmarkResult result;
+        string size, seconds, work, allocations, peakBytes, answer;
+        getline(fields, result.suite, ',');
+        getline(fields, result.name, ',');
+        getline(fields, result.parameters, ',');
+        getline(fields, size, ',');
+        getline(fields, seconds, ',');
+        getline(fields, work, ',');
+        getline(fields, allocations, ',');
+        getline(fields, peakBytes, ',');
+        if (!getline(fields, answer)) {
+            error("readResultsCsv: line " + to_string(number) + " of " + path + " has too few fields");
+        }
+        try {
+            result.size = stoll(size);
+            result.seconds = stod(seconds);
+            result.work = work.empty() ? -1 : stoll(work);
+            result.allocations = stoll(allocations);
+            result.peakBytes = stoll(peakBytes);
+            result.answer = stoll(answer);
+        }
+        catch (const exception&) {
+            error("readResultsCsv: line " + to_string(number) + " of " + path + " has a field that is not a number");
+        }
+        results.add(result);
+    }
+    return results;
+}
+
+/* Prints each result beside its baseline, matched by suite, name and
+ * parameters, and returns the number of regressions: cases that got
+ * slower than the baseline by more than threshold (0.25 is 25%) and by
+ * more than NOISE_SECONDS, or whose answer changed. Cases missing from
+ * either side are listed but do not count.
+ */
+int compareWithBaseline(const Vector<BenchmarkResult>& results, const Vector<BenchmarkResult>& baseline,
+                        double threshold) {
+    Map<string, BenchmarkResult> before;
+    for (const BenchmarkResult& result : baseline) {
+        before[result.suite + "/" + result.name + " " + result.parameters] = result;
+    }
+    int regressions = 0;
+    for (const BenchmarkResult& result : results) {
+        string key = result.suite + "/" + result.name + " " + result.parameters;
+        if (!before.containsKey(key)) {
+            cout << "  new        " << key << endl;
+            continue;
+        }
+        const BenchmarkResult& old = before[key];
+        double ratio = result.seconds / max(old.seconds, 1e-12);
+        string verdict = "ok";
+        if (result.answer != old.answer) {
+            verdict = "WRONG";
+            regressions++;
+        }
+        else if (ratio > 1 + threshold && result.seconds - old.seconds > NOISE_SECONDS) {
+            verdict = "SLOWER";
+            regressions++;
+        }
+        else if (ratio < 1 - threshold && old.seconds - result.seconds > NOISE_SECONDS) {
+            verdict = "faster";
+        }
+        char line[64];
+        snprintf(line, sizeof(line), "  %-10s %7.3fx  ", verdict.c_str(), ratio);
+        cout << line << key << endl;
+        before.remove(key);
+    }
+    for (const string& key : before) {
+        cout << "  missing    " << key << endl;
+    }
+    return regressions;
+}
+
+/* Parses a whole argument as a number of repeats, at least 1. */
+static int parseRepeats(const string& value) {
+    size_t used = 0;
+    int repeats = 0;
+    try {
+        repeats = stoi(value, &used);
+    }
+    catch (const exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size() || repeats < 1) {
+        error("benchmarks: \"" + value + "\" is not a number of repeats");
+    }
+    return repeats;
+}
+
+/* Parses a whole argument as a slowdown threshold, a fraction >= 0. */
+static double parseThreshold(const string& value) {
+    size_t used = 0;
+    double threshold = -1;
+    try {
+        threshold = stod(value, &used);
+    }
+    catch (const exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size() || !(threshold >= 0) || threshold == HUGE_VAL) {
+        error("benchmarks: \"" + value + "\" is not a threshold");
+    }
+    return threshold;
+}
+
+/* Runs the benchmarks from the command line:
+ *
+ *     benchmarks [--quick] [--filter text] [--repeats n] [--csv path]
+ *                [--json path] [--baseline path] [--threshold fraction]
+ *
+ * --quick runs the smallest points of each sweep, --filter only the
+ * cases whose suite, name or parameters contain the text. Each case
+ * runs 5 times by default and is compared by its median time, with a
+ * default threshold of 0.25; both are loose enough that rerunning
+ * against a baseline just written on the same machine reports no
+ * regressions, so the comparison can gate changes. --repeats must be at
+ * least 1 and --threshold at least 0. Returns 1 if any case regressed
+ * against the baseline, 2 on bad arguments.
+ */
+int benchmarkMain(int argc, char* argv[]) {
+    bool quick = false;
+    string filter;
+    int repeats = 5;
+    string csvPath;
+    string jsonPath;
+    string baselinePath;
+    double threshold = 0.25;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--quick") {
+                quick = true;
+            }
+            else if (arg == "--filter" && hasValue) {
+                filter = argv[++i];
+            }
+            else if (arg == "--repeats" && hasValue) {
+                repeats = parseRepeats(argv[++i]);
+            }
+            else if (arg == "--csv" && hasValue) {
+                csvPath = argv[++i];
+            }
+            else if (arg == "--json" && hasValue) {
+                jsonPath = argv[++i];
+            }
+            else if (arg == "--baseline" && hasValue) {
+                baselinePath = argv[++i];
+            }
+            else if (arg == "--threshold" && hasValue) {
+                threshold = parseThreshold(argv[++i]);
+            }
+            else {
+                cerr << "usage: benchmarks [--quick] [--filter text] [--repeats n] [--csv path] [--json path]"
+                     << " [--baseline path] [--threshold fraction]" << endl;
+                return 2;
+            }
+        }
+    }
+    catch (const ErrorException& e) {
+        cerr << e.getMessage() << endl;
+        return 2;
+    }
+
+    try {
+        Vector<BenchmarkCase> cases;
+        addFestivalBenchmarks(cases, quick);
+        addModulationBenchmarks(cases, quick);
+        Vector<BenchmarkResult> results;
+        for (const BenchmarkCase& benchmark : cases) {
+            string label = benchmark.suite + "/" + benchmark.name + " " + benchmark.parameters;
+            if (label.find(filter) == string::npos) {
+                continue;
+            }
+            BenchmarkResult result = runBenchmark(benchmark, repeats);
+            char line[160];
+            snprintf(line, sizeof(line), "%-56s %12.6f s %14s work %10lld allocs %12lld peak bytes",
+                     label.c_str(), result.seconds, workField(result, "-").c_str(), result.allocations,
+                     result.peakBytes);
+            cout << line << endl;
+            results.add(result);
+        }
+        if (!csvPath.empty()) {
+            writeResultsCsv(results, csvPath);
+        }
+        if (!jsonPath.empty()) {
+            writeResultsJson(results, jsonPath);
+        }
+        if (!baselinePath.empty()) {
+            Vector<BenchmarkResult> baseline;
+            for (const BenchmarkResult& result : readResultsCsv(baselinePath)) {
+                if ((result.suite + "/" + result.name + " " + result.parameters).find(filter) != string::npos) {
+                    baseline.add(result);
+                }
+            }
+            int regressions = compareWithBaseline(results, baseline, threshold);
+            cout << regressions << " regressions against " << baselinePath << endl;
+            return regressions > 0 ? 1 : 0;
+        }
+    }
+    catch (const ErrorException& e) {
+        cerr << e.getMessage() << endl;
+        return 2;
+    }
+    return 0;
+}
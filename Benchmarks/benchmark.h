@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include "vector.h"
+
+/* Counters a benchmark fills in while it runs. work is the count the
+ * solver itself reports of the effort it spent, such as states
+ * evaluated, search nodes or keys expanded.
+ */
+struct Probe {
+    long long work = 0;
+};
+
+/* One point of a sweep. run solves the problem once and returns its
+ * answer, which must be the same on every run; the inputs it uses are
+ * built before it is called, from fixed seeds, so they are not timed.
+ * countsWork is false for solvers that report no count of their own,
+ * whose work is then left empty.
+ */
+struct BenchmarkCase {
+    std::string suite;
+    std::string name;
+    std::string parameters;
+    long long size;
+    bool countsWork;
+    std::function<long long(Probe&)> run;
+};
+
+/* What one case measured. seconds is the median of the repeats; the
+ * other fields come from the last one. work is -1 when the case counts
+ * none.
+ */
+struct BenchmarkResult {
+    std::string suite;
+    std::string name;
+    std::string parameters;
+    long long size = 0;
+    double seconds = 0;
+    long long work = -1;
+    long long allocations = 0;
+    long long peakBytes = 0;
+    long long answer = 0;
+};
+
+/* Allocation counters kept by the replacement operator new and delete
+ * in allocationhooks.cpp. resetAllocationCounters zeroes the count and
+ * sets the peak to the bytes live now, so the peak measured afterwards
+ * is relative to that point.
+ */
+void resetAllocationCounters();
+long long allocationCount();
+long long peakAllocatedBytes();
+
+void addFestivalBenchmarks(Vector<BenchmarkCase>& cases, bool quick);
+void addModulationBenchmarks(Vector<BenchmarkCase>& cases, bool quick);
+
+BenchmarkResult runBenchmark(const BenchmarkCase& benchmark, int repeats);
+
+void writeResultsCsv(const Vector<BenchmarkResult>& results, const std::string& path);
+void writeResultsJson(const Vector<BenchmarkResult>& results, const std::string& path);
+Vector<BenchmarkResult> readResultsCsv(const std::string& path);
+int compareWithBaseline(const Vector<BenchmarkResult>& results, const Vector<BenchmarkResult>& baseline,
+                        double threshold);
+
+int benchmarkMain(int argc, char* argv[]);
@@ -0,0 +1,214 @@
+#include "benchmark.h"
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include "eventstream.h"
+#include "festivalplanner.h"
+#include "musicevents.h"
+#include "shardedknapsack.h"
+
+using namespace std;
+
+typedef Vector<pair<int, int>> Events;
+
+/* n events with minutes in [0, maxMinutes] and costs in [1, maxCost],
+ * from a fixed seed, shared by every run of a case.
+ */
+static shared_ptr<const Events> randomEvents(int n, int maxMinutes, int maxCost, unsigned seed) {
+    mt19937 random(seed);
+    auto events = make_shared<Events>();
+    for (int i = 0; i < n; i++) {
+        events->add({int(random() % (maxMinutes + 1)), 1 + int(random() % maxCost)});
+    }
+    return events;
+}
+
+static long long totalCost(const Events& events) {
+    long long total = 0;
+    for (const pair<int, int>& event : events) {
+        total += event.second;
+    }
+    return total;
+}
+
+/* Event files written for the fromFile sweep, in the system's temporary
+ * directory under a name no other run will pick, and removed when the
+ * program exits.
+ */
+struct TemporaryFiles {
+    Vector<string> paths;
+
+    string create(const string& stem) {
+        random_device seed;
+        string path = (filesystem::temp_directory_path() / (stem + "-" + to_string(seed()) + ".bin")).string();
+        paths.add(path);
+        return path;
+    }
+
+    ~TemporaryFiles() {
+        for (const string& path : paths) {
+            remove(path.c_str());
+        }
+    }
+};
+
+static TemporaryFiles temporaryFiles;
+
+/* The points of a sweep to run: all of them, or only the first. */
+static Vector<int> sweep(const Vector<int>& points, bool quick) {
+    return quick ? Vector<int>{points[0]} : points;
+}
+
+static void add(Vector<BenchmarkCase>& cases, const string& name, const string& parameters, long long size,
+                bool countsWork, function<long long(Probe&)> run) {
+    cases.add({"festival", name, parameters, size, countsWork, run});
+}
+
+static string eventParameters(int n, long long money) {
+    return "n=" + to_string(n) + " money=" + to_string(money);
+}
+
+/* Every maxMinutes variant, swept over the number of events and, for
+ * the dense DP, the budget. Each sweep is sized so its largest point
+ * takes on the order of a second. work is filled in only by the solvers
+ * that count their own effort: top-down states, branch and bound nodes,
+ * Pareto frontier entries, scaled DP cells for the approximation and
+ * folds for the planner.
+ */
+void addFestivalBenchmarks(Vector<BenchmarkCase>& cases, bool quick) {
+    for (int n : sweep({12, 16, 20}, quick)) {
+        auto events = randomEvents(n, 150, 100, n);
+        add(cases, "naive", eventParameters(n, 500), n, false, [=](Probe&) {
+            return maxMinutesNaive(*events, 500);
+        });
+    }
+    for (int n : sweep({100, 200, 400}, quick)) {
+        auto events = randomEvents(n, 150, 100, n);
+        add(cases, "memo", eventParameters(n, 1000), n, false, [=](Probe&) {
+            return maxMinutesMemo(*events, 1000);
+        });
+    }
+    for (int n : sweep({1000, 4000, 16000}, quick)) {
+        auto events = randomEvents(n, 150, 1000, n);
+        add(cases, "dp", eventParameters(n, 10000), n, false, [=](Probe&) {
+            return maxMinutesDP(*events, 10000);
+        });
+        add(cases, "dpParallel", eventParameters(n, 10000), n, false, [=](Probe&) {
+            return maxMinutesDPParallel(*events, 10000);
+        });
+        auto quarter = make_shared<const Events>(events->subList(0, n / 4));
+        add(cases, "dp2D", eventParameters(n / 4, 2000) + " hours=2", n / 4, false, [=](Probe&) {
+            return maxMinutesDP2D(*quarter, 2000, 2);
+        });
+        add(cases, "sharded", eventParameters(n, 10000) + " shards=4", n, false, [=](Probe&) {
+            return maxMinutesSharded(*events, 10000, 4);
+        });
+    }
+    for (int money : sweep({1000, 10000, 100000}, quick)) {
+        auto events = randomEvents(2000, 150, 1000, money);
+        add(cases, "dpBudget", eventParameters(2000, money), money, false, [=](Probe&) {
+            return maxMinutesDP(*events, money);
+        });
+        add(cases, "selection", eventParameters(2000, money), money, false, [=](Probe&) {
+            long long minutes = 0;
+            for (int index : maxMinutesWithSelection(*events, money)) {
+                minutes += (*events)[index].first;
+            }
+            return minutes;
+        });
+        add(cases, "budgets", eventParameters(2000, money) + " queries=100", money, false, [=](Probe&) {
+            Vector<int> budgets;
+            for (int i = 1; i <= 100; i++) {
+                budgets.add(money / 100 * i);
+            }
+            long long total = 0;
+            for (long long minutes : maxMinutesForBudgets(*events, budgets)) {
+                total += minutes;
+            }
+            return total;
+        });
+    }
+
+    /* Few events and budgets too large for a row */
+    for (int n : sweep({20, 30, 40}, quick)) {
+        auto events = randomEvents(n, 150, 100000000, n);
+        long long money = totalCost(*events) / 2;
+        add(cases, "meetInMiddle", eventParameters(n, money), n, false, [=](Probe&) {
+            return maxMinutesMeetInMiddle(*events, money);
+        });
+    }
+    for (int n : sweep({30, 60, 120}, quick)) {
+        auto events = randomEvents(n, 150, 100000000, n);
+        long long money = totalCost(*events) / 2;
+        add(cases, "branchAndBound", eventParameters(n, money), n, true, [=](Probe& probe) {
+            return maxMinutesBranchAndBound(*events, money, 0, probe.work);
+        });
+        add(cases, "pareto", eventParameters(n, money), n, true, [=](Probe& probe) {
+            return maxMinutesPareto(*events, money, probe.work);
+        });
+        add(cases, "auto", eventParameters(n, money), n, false, [=](Probe&) {
+            return maxMinutesAuto(*events, money);
+        });
+    }
+    for (int n : sweep({20, 40, 80}, quick)) {
+        auto events = randomEvents(n, 150, 1000, n);
+        long long money = totalCost(*events) / 2;
+        add(cases, "topDown", eventParameters(n, money), n, true, [=](Probe& probe) {
+            TopDownStats stats;
+            long long minutes = maxMinutesTopDown(*events, money, stats);
+            probe.work = stats.states;
+            return minutes;
+        });
+    }
+    for (int n : sweep({1000, 3000, 10000}, quick)) {
+        auto events = randomEvents(n, 150, 100000000, n);
+        long long money = totalCost(*events) / 2;
+        add(cases, "approx", eventParameters(n, money) + " epsilon=0.1", n, true, [=](Probe& probe) {
+            ApproxMinutes approx = maxMinutesApprox(*events, money, 0.1);
+            probe.work = approx.cells;
+            return approx.minutes;
+        });
+    }
+
+    for (int n : sweep({100, 400, 1600}, quick)) {
+        mt19937 random(n);
+        auto bundles = make_shared<Vector<RepeatedEvent>>();
+        for (int i = 0; i < n; i++) {
+            bundles->add({int(random() % 151), 1 + int(random() % 1000), 1 + int(random() % 50)});
+        }
+        for (RepeatStrategy strategy : {RepeatStrategy::BinarySplit, RepeatStrategy::MonotoneQueue}) {
+            string name = strategy == RepeatStrategy::BinarySplit ? "repeatedSplit" : "repeatedQueue";
+            add(cases, name, eventParameters(n, 10000), n, false, [=](Probe&) {
+                return maxMinutesRepeated(*bundles, 10000, strategy);
+            });
+        }
+    }
+
+    /* The file is written once here, outside the timed runs */
+    for (int n : sweep({100000, 1000000}, quick)) {
+        string path = temporaryFiles.create("benchmark-events-" + to_string(n));
+        writeEventsBinary(*randomEvents(n, 150, 1000, n), path);
+        add(cases, "fromFile", eventParameters(n, 1000), n, false, [=](Probe&) {
+            return maxMinutesFromFile(path, 1000);
+        });
+    }
+
+    for (int n : sweep({1000, 4000}, quick)) {
+        auto events = randomEvents(n, 150, 1000, n);
+        add(cases, "planner", eventParameters(n, 10000) + " updates=1000", n, true, [=](Probe& probe) {
+            FestivalPlanner planner(10000);
+            for (const pair<int, int>& event : *events) {
+                planner.addEvent(event.first, event.second);
+            }
+            long long total = planner.maxMinutes();
+            mt19937 random(n);
+            for (int update = 0; update < 1000; update++) {
+                planner.updateEvent(random() % n, random() % 151, 1 + random() % 1000);
+                total += planner.maxMinutes();
+            }
+            probe.work = planner.folds();
+            return total;
+        });
+    }
+}
@@ -0,0 +1,11 @@
+/* The benchmark program, built on its own from this directory together
+ * with the sources of both projects, with all three directories on the
+ * include path. Its replacement operator new counts allocations for the
+ * whole program, which is why it is kept out of the projects' own
+ * builds. See benchmarkMain for its arguments.
+ */
+#include "benchmark.h"
+
+int main(int argc, char* argv[]) {
+    return benchmarkMain(argc, argv);
+}
@@ -0,0 +1,148 @@
+#include "benchmark.h"
+#include <cmath>
+#include <memory>
+#include <random>
+#include <sstream>
+#include "corpusanalyzer.h"
+#include "modulate.h"
+#include "modulationcache.h"
+#include "shortestpaths.h"
+#include "testinputs.h"
+#include "tonalgraph.h"
+
+using namespace std;
+
+static void add(Vector<BenchmarkCase>& cases, const string& name, const string& parameters, long long size,
+                bool countsWork, function<long long(Probe&)> run) {
+    cases.add({"modulation", name, parameters, size, countsWork, run});
+}
+
+static string allowedParameters(int allowed) {
+    string list;
+    for (int relation : relationsOf(allowed)) {
+        list += (list.empty() ? "" : "+") + to_string(relation);
+    }
+    return "allowed=" + list;
+}
+
+/* Every modulate variant, each run from every key to every other key,
+ * swept over the allowed relations; TonalGraph swept over graph size;
+ * Yen's algorithm over k; and the corpus analyser over corpus size.
+ * The answer is the total length of the paths found. work is the keys
+ * expanded, for the searches that report them, and the transitions
+ * analysed for the corpus.
+ */
+void addModulationBenchmarks(Vector<BenchmarkCase>& cases, bool quick) {
+    Vector<int> allowedSets = {0x3f, 0x18, 0x15, 0x29};
+    if (quick) {
+        allowedSets = {0x3f};
+    }
+    for (int allowed : allowedSets) {
+        string parameters = allowedParameters(allowed);
+        int relations = __builtin_popcount(allowed);
+        /* modulateBFS is the ID search behind its string interface; the
+         * original search over key names stays private to modulate.cpp,
+         * where its own time trial compares the two.
+         */
+        add(cases, "bfsStrings", parameters, relations, false, [=](Probe&) {
+            long long total = 0;
+            for (KeyId start = 0; start < NUM_KEYS; start++) {
+                for (KeyId end = 0; end < NUM_KEYS; end++) {
+                    total += modulateBFS(keyName(start), keyName(end), relationsOf(allowed)).size();
+                }
+            }
+            return total;
+        });
+        add(cases, "cached", parameters, relations, false, [=](Probe&) {
+            long long total = 0;
+            for (KeyId start = 0; start < NUM_KEYS; start++) {
+                for (KeyId end = 0; end < NUM_KEYS; end++) {
+                    total += modulateCached(keyName(start), keyName(end), relationsOf(allowed)).size();
+                }
+            }
+            return total;
+        });
+        auto searchIds = [&cases, parameters, relations](const string& name, bool countsWork,
+                                                         function<int(KeyId, KeyId, long long&)> search) {
+            add(cases, name, parameters, relations, countsWork, [=](Probe& probe) {
+                long long total = 0;
+                for (KeyId start = 0; start < NUM_KEYS; start++) {
+                    for (KeyId end = 0; end < NUM_KEYS; end++) {
+                        total += search(start, end, probe.work);
+                    }
+                }
+                return total;
+            });
+        };
+        searchIds("bfs", true, [=](KeyId start, KeyId end, long long& expanded) {
+            return modulateBFSIds(start, end, allowed, expanded).size();
+        });
+        searchIds("iddfs", true, [=](KeyId start, KeyId end, long long& expanded) {
+            return modulateDFSIds(start, end, allowed, expanded).size();
+        });
+        searchIds("bidirectional", true, [=](KeyId start, KeyId end, long long& expanded) {
+            return bidirectionalSearch(KeyGraph{allowed}, start, end, expanded).size();
+        });
+        searchIds("countShortest", false, [=](KeyId start, KeyId end, long long&) {
+            ShortestPathDag dag(KeyGraph{allowed}, start, end);
+            return (int)min(dag.count(), (long long)INT32_MAX);
+        });
+
+        /* Costs falling with the distance each relation covers */
+        Vector<double> costs(NUM_RELATIONS, INFINITY);
+        const double RELATION_COSTS[NUM_RELATIONS] = {5, 4, 4, 1, 1, 2};
+        for (int relation : relationsOf(allowed)) {
+            costs[relation] = RELATION_COSTS[relation];
+        }
+        for (bool heuristic : {true, false}) {
+            searchIds(heuristic ? "astar" : "dijkstra", true, [=](KeyId start, KeyId end, long long& expanded) {
+                double totalCost = 0;
+                return modulateWeightedIds(start, end, costs, heuristic, totalCost, expanded).size();
+            });
+        }
+    }
+
+    for (int k : (quick ? Vector<int>{10} : Vector<int>{10, 100, 1000})) {
+        add(cases, "kShortest", "k=" + to_string(k), k, false, [=](Probe&) {
+            long long total = 0;
+            for (const Vector<int>& path : kShortestPaths(KeyGraph{0x3f}, keyId("C major"), keyId("F# major"), k)) {
+                total += path.size();
+            }
+            return total;
+        });
+    }
+
+    for (int numModes : (quick ? Vector<int>{2} : Vector<int>{2, 7, 20, 50, 100})) {
+        auto graph = make_shared<TonalGraph>();
+        if (numModes == 2) {
+            *graph = TonalGraph::standard();
+        }
+        else if (numModes == 7) {
+            *graph = TonalGraph::modal();
+        }
+        else {
+            istringstream table(generatedTable(numModes, 4 * numModes, numModes));
+            *graph = TonalGraph::parse(table);
+        }
+        add(cases, "tonalGraph", "keys=" + to_string(graph->size()) + " queries=10000", graph->size(), true,
+            [=](Probe& probe) {
+                mt19937 random(2024);
+                long long total = 0;
+                for (int query = 0; query < 10000; query++) {
+                    total += graph->shortestPath(random() % graph->size(), random() % graph->size(), probe.work).size();
+                }
+                return total;
+            });
+    }
+
+    for (int pieces : (quick ? Vector<int>{10000} : Vector<int>{10000, 100000, 500000})) {
+        auto corpus = make_shared<const string>(generatedCorpus(pieces, pieces));
+        add(cases, "corpus", "pieces=" + to_string(pieces), pieces, true, [=](Probe& probe) {
+            istringstream in(*corpus);
+            ostringstream report;
+            CorpusStats totals = analyzeCorpus(in, report, {0, 1, 2, 3, 4, 5});
+            probe.work = totals.transitions;
+            return totals.totalDistance;
+        });
+    }
+}
@@ -0,0 +1,49 @@
+#include "dparena.h"
+#include <new>
+
+using namespace std;
+
+DPArena::~DPArena() {
+    release();
+}
+
+/* Returns a buffer of at least the given size for the slot, rounded up
+ * to a whole number of cache lines. The old buffer is only replaced
+ * when it is too small, and its contents are not preserved.
+ */
+void* DPArena::reserve(size_t bytes, int slot) {
+    while (blocks.size() <= slot) {
+        blocks.add({nullptr, 0});
+    }
+    Block& block = blocks[slot];
+    if (block.bytes < bytes) {
+        size_t rounded = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        ::operator delete(block.data, align_val_t(CACHE_LINE));
+        block.data = nullptr;
+        block.bytes = 0;
+        block.data = ::operator new(rounded, align_val_t(CACHE_LINE));
+        block.bytes = rounded;
+        allocationCount++;
+    }
+    return block.data;
+}
+
+/* Frees every slot; the arena can still be reused afterwards. */
+void DPArena::release() {
+    for (Block& block : blocks) {
+        ::operator delete(block.data, align_val_t(CACHE_LINE));
+    }
+    blocks.clear();
+}
+
+size_t DPArena::bytesReserved() const {
+    size_t total = 0;
+    for (const Block& block : blocks) {
+        total += block.bytes;
+    }
+    return total;
+}
+
+int DPArena::allocations() const {
+    return allocationCount;
+}
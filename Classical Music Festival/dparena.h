@@ -0,0 +1,42 @@
+#ifndef DPARENA_H
+#define DPARENA_H
+#pragma once
+
+#include <cstddef>
+#include "vector.h"
+
+/* A reusable pool of cache-line-aligned DP rows. Each slot keeps the
+ * largest buffer it has been asked for, so a solver that is called
+ * repeatedly with the same (or a smaller) budget never allocates after
+ * the first call. Rows handed out are uninitialized; the solver is
+ * responsible for clearing the prefix it uses.
+ */
+class DPArena {
+public:
+    static const size_t CACHE_LINE = 64;
+
+    DPArena() = default;
+    ~DPArena();
+    DPArena(const DPArena&) = delete;
+    DPArena& operator=(const DPArena&) = delete;
+
+    template <typename T>
+    T* row(int length, int slot = 0) {
+        return static_cast<T*>(reserve(size_t(length) * sizeof(T), slot));
+    }
+
+    void* reserve(size_t bytes, int slot = 0);
+    void release();
+    size_t bytesReserved() const;
+    int allocations() const;
+
+private:
+    struct Block {
+        void* data;
+        size_t bytes;
+    };
+    Vector<Block> blocks;
+    int allocationCount = 0;
+};
+
+#endif // DPARENA_H
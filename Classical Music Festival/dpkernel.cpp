@@ -0,0 +1,370 @@
+#include "dpkernel.h"
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DPKERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/** Vectorized 0/1 Knapsack Row Update
+ *  Time Complexity: O(m/w) per event, w is the number of SIMD lanes
+ *  Space Complexity: O(m), a single row updated in place
+ **/
+
+/* Every kernel below computes, for cost <= j <= money,
+ *     row[j] = max(row[j], row[j - cost] + duration)
+ * sweeping j from the top of the budget downward. Because the sweep
+ * is descending, row[j - cost] has not yet been overwritten for the
+ * current event, so one row can safely replace the two rows the
+ * original DP kept. The vector versions process w lanes at a time:
+ * a block at j reads row[j - cost .. j - cost + w - 1], and every
+ * index already written is at least j + w, so the loads always see
+ * the previous event's values as long as both loads happen before
+ * the store. Whatever is left below the last full block is finished
+ * by the scalar loop.
+ *
+ * Rows are unsigned, and the caller picks a type wide enough for the
+ * total duration of all events, so the additions never wrap. That
+ * lets uint16_t rows pack twice as many lanes into a register as
+ * uint32_t rows.
+ */
+
+template <typename T>
+static void rowUpdateScalar(T* row, int money, int cost, T duration) {
+    for (int j = money; j >= cost; j--) {
+        row[j] = max(row[j], T(row[j - cost] + duration));
+    }
+}
+
+/* The range form reads one row and writes another, covering only the
+ * budgets lo <= j < hi. It is what the parallel DP uses, since there
+ * each thread owns a slice of the row while its neighbours are still
+ * reading from theirs, so updating in place is no longer safe.
+ */
+template <typename T>
+static void rangeUpdateScalar(const T* in, T* out, int lo, int hi, int cost, T duration) {
+    int split = max(lo, min(cost, hi));
+    copy(in + lo, in + split, out + lo);
+    for (int j = split; j < hi; j++) {
+        out[j] = max(in[j], T(in[j - cost] + duration));
+    }
+}
+
+/* The shift-max form, out[j] = max(out[j], in[j - shift] + add), is
+ * the building block of a (max,+) convolution: applying it once for
+ * every breakpoint of one curve, always reading the same other curve,
+ * combines the two. Unlike the knapsack updates it keeps whatever out
+ * already holds.
+ */
+template <typename T>
+static void shiftMaxScalar(const T* in, T* out, int lo, int hi, int shift, T add) {
+    for (int j = max(lo, shift); j < hi; j++) {
+        out[j] = max(out[j], T(in[j - shift] + add));
+    }
+}
+
+#ifdef DPKERNEL_X86
+
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw")))
+
+/* Each Ops struct wraps the load, broadcast, add and max intrinsics
+ * for one (instruction set, value type) pair, so the sweep itself is
+ * written only once per instruction set.
+ */
+
+struct SSE41U16 {
+    static const int lanes = 8;
+    SSE41_TARGET static __m128i load(const uint16_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    SSE41_TARGET static void store(uint16_t* p, __m128i v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    SSE41_TARGET static __m128i set1(uint16_t x) { return _mm_set1_epi16(short(x)); }
+    SSE41_TARGET static __m128i add(__m128i a, __m128i b) { return _mm_add_epi16(a, b); }
+    SSE41_TARGET static __m128i max(__m128i a, __m128i b) { return _mm_max_epu16(a, b); }
+};
+
+struct SSE41U32 {
+    static const int lanes = 4;
+    SSE41_TARGET static __m128i load(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    SSE41_TARGET static void store(uint32_t* p, __m128i v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    SSE41_TARGET static __m128i set1(uint32_t x) { return _mm_set1_epi32(int(x)); }
+    SSE41_TARGET static __m128i add(__m128i a, __m128i b) { return _mm_add_epi32(a, b); }
+    SSE41_TARGET static __m128i max(__m128i a, __m128i b) { return _mm_max_epu32(a, b); }
+};
+
+struct AVX2U16 {
+    static const int lanes = 16;
+    AVX2_TARGET static __m256i load(const uint16_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    AVX2_TARGET static void store(uint16_t* p, __m256i v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    AVX2_TARGET static __m256i set1(uint16_t x) { return _mm256_set1_epi16(short(x)); }
+    AVX2_TARGET static __m256i add(__m256i a, __m256i b) { return _mm256_add_epi16(a, b); }
+    AVX2_TARGET static __m256i max(__m256i a, __m256i b) { return _mm256_max_epu16(a, b); }
+};
+
+struct AVX2U32 {
+    static const int lanes = 8;
+    AVX2_TARGET static __m256i load(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    AVX2_TARGET static void store(uint32_t* p, __m256i v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    AVX2_TARGET static __m256i set1(uint32_t x) { return _mm256_set1_epi32(int(x)); }
+    AVX2_TARGET static __m256i add(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+    AVX2_TARGET static __m256i max(__m256i a, __m256i b) { return _mm256_max_epu32(a, b); }
+};
+
+/* AVX2 has no unsigned 64-bit max, but totals never reach 2^63, so a
+ * signed compare and blend gives the same answer.
+ */
+struct AVX2U64 {
+    static const int lanes = 4;
+    AVX2_TARGET static __m256i load(const uint64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    AVX2_TARGET static void store(uint64_t* p, __m256i v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    AVX2_TARGET static __m256i set1(uint64_t x) { return _mm256_set1_epi64x((long long)(x)); }
+    AVX2_TARGET static __m256i add(__m256i a, __m256i b) { return _mm256_add_epi64(a, b); }
+    AVX2_TARGET static __m256i max(__m256i a, __m256i b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(b, a)); }
+};
+
+struct AVX512U16 {
+    static const int lanes = 32;
+    AVX512_TARGET static __m512i load(const uint16_t* p) { return _mm512_loadu_si512(p); }
+    AVX512_TARGET static void store(uint16_t* p, __m512i v) { _mm512_storeu_si512(p, v); }
+    AVX512_TARGET static __m512i set1(uint16_t x) { return _mm512_set1_epi16(short(x)); }
+    AVX512_TARGET static __m512i add(__m512i a, __m512i b) { return _mm512_add_epi16(a, b); }
+    AVX512_TARGET static __m512i max(__m512i a, __m512i b) { return _mm512_max_epu16(a, b); }
+};
+
+struct AVX512U32 {
+    static const int lanes = 16;
+    AVX512_TARGET static __m512i load(const uint32_t* p) { return _mm512_loadu_si512(p); }
+    AVX512_TARGET static void store(uint32_t* p, __m512i v) { _mm512_storeu_si512(p, v); }
+    AVX512_TARGET static __m512i set1(uint32_t x) { return _mm512_set1_epi32(int(x)); }
+    AVX512_TARGET static __m512i add(__m512i a, __m512i b) { return _mm512_add_epi32(a, b); }
+    AVX512_TARGET static __m512i max(__m512i a, __m512i b) { return _mm512_max_epu32(a, b); }
+};
+
+struct AVX512U64 {
+    static const int lanes = 8;
+    AVX512_TARGET static __m512i load(const uint64_t* p) { return _mm512_loadu_si512(p); }
+    AVX512_TARGET static void store(uint64_t* p, __m512i v) { _mm512_storeu_si512(p, v); }
+    AVX512_TARGET static __m512i set1(uint64_t x) { return _mm512_set1_epi64((long long)(x)); }
+    AVX512_TARGET static __m512i add(__m512i a, __m512i b) { return _mm512_add_epi64(a, b); }
+    AVX512_TARGET static __m512i max(__m512i a, __m512i b) { return _mm512_max_epu64(a, b); }
+};
+
+/* The sweep is stamped out once per instruction set because the
+ * target attribute has to sit on the function that contains the
+ * inlined intrinsics.
+ */
+#define DEFINE_VECTOR_ROW_UPDATE(NAME, TARGET)                              \
+    template <typename Ops, typename T>                                     \
+    TARGET static void NAME(T* row, int money, int cost, T duration) {      \
+        const int lanes = Ops::lanes;                                       \
+        auto add = Ops::set1(duration);                                     \
+        int j = money - lanes + 1;                                          \
+        for (; j >= cost; j -= lanes) {                                     \
+            auto keep = Ops::load(row + j);                                 \
+            auto take = Ops::add(Ops::load(row + j - cost), add);           \
+            Ops::store(row + j, Ops::max(keep, take));                      \
+        }                                                                   \
+        rowUpdateScalar(row, j + lanes - 1, cost, duration);                \
+    }
+
+#define DEFINE_VECTOR_RANGE_UPDATE(NAME, TARGET)                                        \
+    template <typename Ops, typename T>                                                 \
+    TARGET static void NAME(const T* in, T* out, int lo, int hi, int cost, T duration) { \
+        const int lanes = Ops::lanes;                                                   \
+        auto add = Ops::set1(duration);                                                 \
+        int j = max(lo, min(cost, hi));                                                 \
+        copy(in + lo, in + j, out + lo);                                                \
+        for (; j + lanes <= hi; j += lanes) {                                           \
+            auto take = Ops::add(Ops::load(in + j - cost), add);                        \
+            Ops::store(out + j, Ops::max(Ops::load(in + j), take));                     \
+        }                                                                               \
+        rangeUpdateScalar(in, out, j, hi, cost, duration);                              \
+    }
+
+#define DEFINE_VECTOR_SHIFT_MAX(NAME, TARGET)                                           \
+    template <typename Ops, typename T>                                                 \
+    TARGET static void NAME(const T* in, T* out, int lo, int hi, int shift, T add) {    \
+        const int lanes = Ops::lanes;                                                   \
+        auto plus = Ops::set1(add);                                                     \
+        int j = max(lo, shift);                                                         \
+        for (; j + lanes <= hi; j += lanes) {                                           \
+            auto take = Ops::add(Ops::load(in + j - shift), plus);                      \
+            Ops::store(out + j, Ops::max(Ops::load(out + j), take));                    \
+        }                                                                               \
+        shiftMaxScalar(in, out, j, hi, shift, add);                                     \
+    }
+
+DEFINE_VECTOR_ROW_UPDATE(rowUpdateSSE41, SSE41_TARGET)
+DEFINE_VECTOR_ROW_UPDATE(rowUpdateAVX2, AVX2_TARGET)
+DEFINE_VECTOR_ROW_UPDATE(rowUpdateAVX512, AVX512_TARGET)
+DEFINE_VECTOR_RANGE_UPDATE(rangeUpdateSSE41, SSE41_TARGET)
+DEFINE_VECTOR_RANGE_UPDATE(rangeUpdateAVX2, AVX2_TARGET)
+DEFINE_VECTOR_RANGE_UPDATE(rangeUpdateAVX512, AVX512_TARGET)
+DEFINE_VECTOR_SHIFT_MAX(shiftMaxSSE41, SSE41_TARGET)
+DEFINE_VECTOR_SHIFT_MAX(shiftMaxAVX2, AVX2_TARGET)
+DEFINE_VECTOR_SHIFT_MAX(shiftMaxAVX512, AVX512_TARGET)
+
+#endif // DPKERNEL_X86
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Asks the CPU (and, through the compiler builtins, the operating
+ * system) which vector extensions are usable. The AVX-512 level
+ * needs the byte/word extension as well as the foundation set so the
+ * uint16_t rows can use it. Non-x86 builds always run the scalar kernel.
+ */
+SimdLevel detectSimdLevel() {
+#ifdef DPKERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SimdLevel::SSE41;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+static SimdLevel currentLevel = detectSimdLevel();
+
+SimdLevel activeSimdLevel() {
+    return currentLevel;
+}
+
+/* Forces the kernel down to a lower instruction set, which the time
+ * trials use to compare levels on the same machine. Requests above
+ * what the CPU supports are clamped to the detected level.
+ */
+void setSimdLevel(SimdLevel level) {
+    currentLevel = min(level, detectSimdLevel());
+}
+
+string simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE41: return "SSE4.1";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        default: return "scalar";
+    }
+}
+
+/* Main entry points: apply one event (cost, duration) to a DP row of
+ * length money + 1 using the active instruction set. SSE4.1 has no
+ * 64-bit compare, so uint64_t rows skip straight from AVX2 to scalar.
+ */
+void knapsackRowUpdate(uint16_t* row, int money, int cost, uint16_t duration) {
+    if (cost > money) {
+        return;
+    }
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: rowUpdateAVX512<AVX512U16>(row, money, cost, duration); return;
+        case SimdLevel::AVX2: rowUpdateAVX2<AVX2U16>(row, money, cost, duration); return;
+        case SimdLevel::SSE41: rowUpdateSSE41<SSE41U16>(row, money, cost, duration); return;
+#endif
+        default: rowUpdateScalar(row, money, cost, duration); return;
+    }
+}
+
+void knapsackRowUpdate(uint32_t* row, int money, int cost, uint32_t duration) {
+    if (cost > money) {
+        return;
+    }
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: rowUpdateAVX512<AVX512U32>(row, money, cost, duration); return;
+        case SimdLevel::AVX2: rowUpdateAVX2<AVX2U32>(row, money, cost, duration); return;
+        case SimdLevel::SSE41: rowUpdateSSE41<SSE41U32>(row, money, cost, duration); return;
+#endif
+        default: rowUpdateScalar(row, money, cost, duration); return;
+    }
+}
+
+void knapsackRowUpdate(uint64_t* row, int money, int cost, uint64_t duration) {
+    if (cost > money) {
+        return;
+    }
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: rowUpdateAVX512<AVX512U64>(row, money, cost, duration); return;
+        case SimdLevel::AVX2: rowUpdateAVX2<AVX2U64>(row, money, cost, duration); return;
+#endif
+        default: rowUpdateScalar(row, money, cost, duration); return;
+    }
+}
+
+/* Range entry points: out[j] = max(in[j], in[j - cost] + duration) for
+ * lo <= j < hi, copying in[j] where j < cost. in and out must not overlap.
+ */
+void knapsackRangeUpdate(const uint16_t* in, uint16_t* out, int lo, int hi, int cost, uint16_t duration) {
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: rangeUpdateAVX512<AVX512U16>(in, out, lo, hi, cost, duration); return;
+        case SimdLevel::AVX2: rangeUpdateAVX2<AVX2U16>(in, out, lo, hi, cost, duration); return;
+        case SimdLevel::SSE41: rangeUpdateSSE41<SSE41U16>(in, out, lo, hi, cost, duration); return;
+#endif
+        default: rangeUpdateScalar(in, out, lo, hi, cost, duration); return;
+    }
+}
+
+void knapsackRangeUpdate(const uint32_t* in, uint32_t* out, int lo, int hi, int cost, uint32_t duration) {
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: rangeUpdateAVX512<AVX512U32>(in, out, lo, hi, cost, duration); return;
+        case SimdLevel::AVX2: rangeUpdateAVX2<AVX2U32>(in, out, lo, hi, cost, duration); return;
+        case SimdLevel::SSE41: rangeUpdateSSE41<SSE41U32>(in, out, lo, hi, cost, duration); return;
+#endif
+        default: rangeUpdateScalar(in, out, lo, hi, cost, duration); return;
+    }
+}
+
+void knapsackRangeUpdate(const uint64_t* in, uint64_t* out, int lo, int hi, int cost, uint64_t duration) {
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: rangeUpdateAVX512<AVX512U64>(in, out, lo, hi, cost, duration); return;
+        case SimdLevel::AVX2: rangeUpdateAVX2<AVX2U64>(in, out, lo, hi, cost, duration); return;
+#endif
+        default: rangeUpdateScalar(in, out, lo, hi, cost, duration); return;
+    }
+}
+
+/* Shift-max entry points: out[j] = max(out[j], in[j - shift] + add)
+ * for lo <= j < hi and j >= shift. in and out must not overlap.
+ */
+void knapsackShiftMax(const uint16_t* in, uint16_t* out, int lo, int hi, int shift, uint16_t add) {
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: shiftMaxAVX512<AVX512U16>(in, out, lo, hi, shift, add); return;
+        case SimdLevel::AVX2: shiftMaxAVX2<AVX2U16>(in, out, lo, hi, shift, add); return;
+        case SimdLevel::SSE41: shiftMaxSSE41<SSE41U16>(in, out, lo, hi, shift, add); return;
+#endif
+        default: shiftMaxScalar(in, out, lo, hi, shift, add); return;
+    }
+}
+
+void knapsackShiftMax(const uint32_t* in, uint32_t* out, int lo, int hi, int shift, uint32_t add) {
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: shiftMaxAVX512<AVX512U32>(in, out, lo, hi, shift, add); return;
+        case SimdLevel::AVX2: shiftMaxAVX2<AVX2U32>(in, out, lo, hi, shift, add); return;
+        case SimdLevel::SSE41: shiftMaxSSE41<SSE41U32>(in, out, lo, hi, shift, add); return;
+#endif
+        default: shiftMaxScalar(in, out, lo, hi, shift, add); return;
+    }
+}
+
+void knapsackShiftMax(const uint64_t* in, uint64_t* out, int lo, int hi, int shift, uint64_t add) {
+    switch (currentLevel) {
+#ifdef DPKERNEL_X86
+        case SimdLevel::AVX512: shiftMaxAVX512<AVX512U64>(in, out, lo, hi, shift, add); return;
+        case SimdLevel::AVX2: shiftMaxAVX2<AVX2U64>(in, out, lo, hi, shift, add); return;
+#endif
+        default: shiftMaxScalar(in, out, lo, hi, shift, add); return;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef DPKERNEL_H
+#define DPKERNEL_H
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/* Instruction set levels for the knapsack row kernel, ordered from
+ * least to most capable. The best level supported by the running CPU
+ * is detected once and used for every subsequent row update.
+ */
+enum class SimdLevel {
+    Scalar,
+    SSE41,
+    AVX2,
+    AVX512
+};
+
+SimdLevel detectSimdLevel();
+SimdLevel activeSimdLevel();
+void setSimdLevel(SimdLevel level);
+std::string simdLevelName(SimdLevel level);
+
+void knapsackRowUpdate(uint16_t* row, int money, int cost, uint16_t duration);
+void knapsackRowUpdate(uint32_t* row, int money, int cost, uint32_t duration);
+void knapsackRowUpdate(uint64_t* row, int money, int cost, uint64_t duration);
+
+void knapsackRangeUpdate(const uint16_t* in, uint16_t* out, int lo, int hi, int cost, uint16_t duration);
+void knapsackRangeUpdate(const uint32_t* in, uint32_t* out, int lo, int hi, int cost, uint32_t duration);
+void knapsackRangeUpdate(const uint64_t* in, uint64_t* out, int lo, int hi, int cost, uint64_t duration);
+
+void knapsackShiftMax(const uint16_t* in, uint16_t* out, int lo, int hi, int shift, uint16_t add);
+void knapsackShiftMax(const uint32_t* in, uint32_t* out, int lo, int hi, int shift, uint32_t add);
+void knapsackShiftMax(const uint64_t* in, uint64_t* out, int lo, int hi, int shift, uint64_t add);
+
+#endif // DPKERNEL_H
@@ -0,0 +1,520 @@
+#include "eventstream.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "dparena.h"
+#include "dpkernel.h"
+#include "musicevents.h"
+#include "threadpool.h"
+#include "error.h"
+#include "testing/SimpleTest.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define EVENTS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/* A read-only view of a whole file. On POSIX systems the file is
+ * memory-mapped, so catalogues larger than RAM only ever occupy the
+ * pages currently being parsed: the mapping is marked sequential, and
+ * pages behind the reader are handed back with consumed(). Elsewhere
+ * the file is read into memory in one go.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+#ifdef EVENTS_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            error("MappedFile: could not open " + path);
+        }
+        length = size_t(info.st_size);
+        if (length > 0) {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                error("MappedFile: could not map " + path);
+            }
+            madvise(mapped, length, MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(mapped);
+        }
+        close(fd);
+#else
+        ifstream in(path, ios::binary);
+        if (!in) {
+            error("MappedFile: could not open " + path);
+        }
+        contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        bytes = contents.data();
+        length = contents.size();
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef EVENTS_MMAP
+        if (bytes != nullptr) {
+            munmap(const_cast<char*>(bytes), length);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    /* Drops the whole pages before offset from memory; they are read
+     * back from the file if they are ever touched again.
+     */
+    void consumed(size_t offset) {
+#ifdef EVENTS_MMAP
+        size_t page = size_t(sysconf(_SC_PAGESIZE));
+        size_t end = offset / page * page;
+        if (end > released) {
+            madvise(const_cast<char*>(bytes) + released, end - released, MADV_DONTNEED);
+            released = end;
+        }
+#else
+        (void) offset;
+#endif
+    }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef EVENTS_MMAP
+    size_t released = 0;
+#else
+    vector<char> contents;
+#endif
+};
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+static const char BINARY_TAG[4] = {'E', 'V', 'T', '1'};
+static const size_t BINARY_HEADER = 12;
+static const size_t BINARY_RECORD = 8;
+
+/* Each batch gives every thread CHUNK_BYTES of the file. A CSV line is
+ * at least 4 bytes ("1,1" and a newline), so a buffer reserved for
+ * CHUNK_BYTES / 4 events is never outgrown, and after the first batch
+ * parsing allocates nothing at all.
+ */
+static const size_t CHUNK_BYTES = 1 << 20;
+static const size_t MIN_CSV_LINE = 4;
+
+static uint32_t readLittle32(const char* at) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(at);
+    return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+}
+
+static void writeLittle32(char* at, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        at[i] = char(value >> (8 * i));
+    }
+}
+
+EventFormat detectEventFormat(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        error("detectEventFormat: could not open " + path);
+    }
+    char tag[4] = {};
+    in.read(tag, sizeof(tag));
+    return in && equal(tag, tag + 4, BINARY_TAG) ? EventFormat::Binary : EventFormat::Csv;
+}
+
+/* Parses a non-negative decimal int, advancing at past its digits. */
+static bool parseCount(const char*& at, const char* end, int& value) {
+    if (at == end || *at < '0' || *at > '9') {
+        return false;
+    }
+    long long parsed = 0;
+    while (at < end && *at >= '0' && *at <= '9') {
+        parsed = parsed * 10 + (*at - '0');
+        if (parsed > INT_MAX) {
+            return false;
+        }
+        at++;
+    }
+    value = int(parsed);
+    return true;
+}
+
+static void skipBlanks(const char*& at, const char* end) {
+    while (at < end && (*at == ' ' || *at == '\t' || *at == '\r')) {
+        at++;
+    }
+}
+
+/* A header names its columns, so it holds at least one letter; a line
+ * of numbers, signed or not, is data and parsed like any other.
+ */
+static bool isHeader(const char* at, const char* end) {
+    for (; at < end; at++) {
+        if ((*at >= 'a' && *at <= 'z') || (*at >= 'A' && *at <= 'Z')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Parses the CSV lines that start in [lo, hi) of the file. A chunk that
+ * starts mid-line leaves that line to the chunk before it and instead
+ * finishes the last line it starts, even past hi, so every line is
+ * parsed exactly once. A first line with a letter in it is taken as a
+ * header. Problems are reported by byte offset, since a
+ * chunk does not know its line numbers.
+ */
+static void parseCsvChunk(const char* file, size_t fileSize, size_t lo, size_t hi,
+                          vector<pair<int, int>>& out, string& problem) {
+    const char* end = file + fileSize;
+    const char* at = file + lo;
+    if (lo > 0 && file[lo - 1] != '\n') {
+        at = static_cast<const char*>(memchr(at, '\n', end - at));
+        at = (at == nullptr) ? end : at + 1;
+    }
+    while (at < file + hi) {
+        const char* line = at;
+        const char* next = static_cast<const char*>(memchr(at, '\n', end - at));
+        const char* lineEnd = (next == nullptr) ? end : next;
+        at = (next == nullptr) ? end : next + 1;
+        const char* p = line;
+        skipBlanks(p, lineEnd);
+        if (p == lineEnd) {
+            continue;
+        }
+        if (line == file && isHeader(p, lineEnd)) {
+            continue;
+        }
+        pair<int, int> event;
+        bool ok = parseCount(p, lineEnd, event.first);
+        skipBlanks(p, lineEnd);
+        ok = ok && p < lineEnd && *p++ == ',';
+        skipBlanks(p, lineEnd);
+        ok = ok && parseCount(p, lineEnd, event.second);
+        skipBlanks(p, lineEnd);
+        if (!ok || p != lineEnd) {
+            problem = "malformed event at byte " + to_string(line - file) +
+                      " (expected two non-negative integers \"minutes,cost\")";
+            return;
+        }
+        out.push_back(event);
+    }
+}
+
+static void parseBinaryChunk(const char* file, size_t first, size_t last, vector<pair<int, int>>& out,
+                             string& problem) {
+    for (size_t r = first; r < last; r++) {
+        const char* record = file + BINARY_HEADER + r * BINARY_RECORD;
+        uint32_t minutes = readLittle32(record);
+        uint32_t cost = readLittle32(record + 4);
+        if (minutes > INT_MAX || cost > INT_MAX) {
+            problem = "negative event at record " + to_string(r);
+            return;
+        }
+        out.push_back({int(minutes), int(cost)});
+    }
+}
+
+/* Batches are cut from the file one after another; within a batch each
+ * thread parses its own slice into its own buffer, and the buffers are
+ * then handed to consume in order, so the events arrive in file order.
+ * Parse errors are carried back to this thread and raised here, since
+ * an exception cannot cross the pool.
+ */
+void forEachEventBatch(const string& path,
+                       const function<void(const pair<int, int>* events, size_t count)>& consume,
+                       int threads) {
+    EventFormat format = detectEventFormat(path);
+    MappedFile file(path);
+    size_t begin = 0;
+    size_t end = file.size();
+    if (format == EventFormat::Binary) {
+        if (file.size() < BINARY_HEADER) {
+            error("forEachEventBatch: " + path + " has a truncated header");
+        }
+        uint64_t count = uint64_t(readLittle32(file.data() + 4)) | uint64_t(readLittle32(file.data() + 8)) << 32;
+        if (count != (file.size() - BINARY_HEADER) / BINARY_RECORD ||
+            (file.size() - BINARY_HEADER) % BINARY_RECORD != 0) {
+            error("forEachEventBatch: " + path + " does not hold the number of events its header gives");
+        }
+        begin = 0;
+        end = size_t(count);
+    }
+    size_t unitBytes = (format == EventFormat::Binary) ? BINARY_RECORD : 1;
+    size_t unitsPerChunk = CHUNK_BYTES / unitBytes;
+    if (threads <= 0) {
+        threads = ThreadPool::hardwareThreads();
+    }
+    threads = int(max(size_t(1), min(size_t(threads), (end - begin + unitsPerChunk - 1) / unitsPerChunk)));
+
+    vector<vector<pair<int, int>>> buffers(threads);
+    for (vector<pair<int, int>>& buffer : buffers) {
+        buffer.reserve(format == EventFormat::Binary ? unitsPerChunk : CHUNK_BYTES / MIN_CSV_LINE + 1);
+    }
+    vector<string> problems(threads);
+    for (size_t offset = begin; offset < end;) {
+        size_t batchEnd = min(end, offset + size_t(threads) * unitsPerChunk);
+        ThreadPool::shared().run(threads, [&](int t) {
+            size_t lo = offset + (batchEnd - offset) * t / threads;
+            size_t hi = offset + (batchEnd - offset) * (t + 1) / threads;
+            buffers[t].clear();
+            if (format == EventFormat::Binary) {
+                parseBinaryChunk(file.data(), lo, hi, buffers[t], problems[t]);
+            }
+            else {
+                parseCsvChunk(file.data(), file.size(), lo, hi, buffers[t], problems[t]);
+            }
+        });
+        for (int t = 0; t < threads; t++) {
+            if (!problems[t].empty()) {
+                error("forEachEventBatch: " + path + ": " + problems[t]);
+            }
+        }
+        for (const vector<pair<int, int>>& buffer : buffers) {
+            if (!buffer.empty()) {
+                consume(buffer.data(), buffer.size());
+            }
+        }
+        file.consumed(format == EventFormat::Binary ? BINARY_HEADER + offset * BINARY_RECORD : offset);
+        offset = batchEnd;
+    }
+}
+
+Vector<pair<int, int>> loadEvents(const string& path, int threads) {
+    Vector<pair<int, int>> events;
+    forEachEventBatch(path, [&](const pair<int, int>* batch, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            events.add(batch[i]);
+        }
+    }, threads);
+    return events;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Streaming DP: every event goes straight from the parse buffers into
+ * the row update, so no event list is ever built and memory stays at
+ * one row plus the buffers, however long the catalogue. The row type
+ * cannot be chosen up front without reading the file twice, so the row
+ * starts as uint16_t and is widened in place (into another arena slot)
+ * the first time the affordable minutes seen so far outgrow it; every
+ * entry is bounded by that running total, so nothing is lost.
+ */
+long long maxMinutesFromFile(const string& path, int money, int threads) {
+    if (money < 0) {
+        return 0;
+    }
+    static thread_local DPArena arena;
+    int length = money + 1;
+    uint16_t* row16 = arena.row<uint16_t>(length, 0);
+    uint32_t* row32 = nullptr;
+    uint64_t* row64 = nullptr;
+    fill(row16, row16 + length, uint16_t(0));
+    long long total = 0;
+    forEachEventBatch(path, [&](const pair<int, int>* events, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            int minutes = events[i].first;
+            int cost = events[i].second;
+            if (cost > money) {
+                continue;
+            }
+            total += minutes;
+            if (row32 == nullptr && total > UINT16_MAX) {
+                row32 = arena.row<uint32_t>(length, 1);
+                copy(row16, row16 + length, row32);
+            }
+            if (row64 == nullptr && total > UINT32_MAX) {
+                row64 = arena.row<uint64_t>(length, 2);
+                copy(row32, row32 + length, row64);
+            }
+            if (row64 != nullptr) {
+                knapsackRowUpdate(row64, money, cost, uint64_t(minutes));
+            }
+            else if (row32 != nullptr) {
+                knapsackRowUpdate(row32, money, cost, uint32_t(minutes));
+            }
+            else {
+                knapsackRowUpdate(row16, money, cost, uint16_t(minutes));
+            }
+        }
+    }, threads);
+    if (row64 != nullptr) {
+        return (long long)(row64[money]);
+    }
+    return (row32 != nullptr) ? (long long)(row32[money]) : row16[money];
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Writes the binary header with the given count. */
+static void writeBinaryHeader(ofstream& out, uint64_t count) {
+    char header[BINARY_HEADER];
+    memcpy(header, BINARY_TAG, sizeof(BINARY_TAG));
+    writeLittle32(header + 4, uint32_t(count));
+    writeLittle32(header + 8, uint32_t(count >> 32));
+    out.write(header, sizeof(header));
+}
+
+static void writeBinaryRecords(ofstream& out, const pair<int, int>* events, size_t count, vector<char>& encoded) {
+    encoded.resize(count * BINARY_RECORD);
+    for (size_t i = 0; i < count; i++) {
+        writeLittle32(encoded.data() + i * BINARY_RECORD, uint32_t(events[i].first));
+        writeLittle32(encoded.data() + i * BINARY_RECORD + 4, uint32_t(events[i].second));
+    }
+    out.write(encoded.data(), encoded.size());
+}
+
+void writeEventsBinary(const Vector<pair<int, int>>& events, const string& path) {
+    for (const pair<int, int>& event : events) {
+        if (event.first < 0 || event.second < 0) {
+            error("writeEventsBinary: event durations and costs must be non-negative");
+        }
+    }
+    ofstream out(path, ios::binary);
+    writeBinaryHeader(out, events.size());
+    vector<pair<int, int>> batch(events.begin(), events.end());
+    vector<char> encoded;
+    writeBinaryRecords(out, batch.data(), batch.size(), encoded);
+    if (!out) {
+        error("writeEventsBinary: could not write " + path);
+    }
+}
+
+/* Converts any events file to the binary format in one streaming pass.
+ * The count is only known at the end, so the header is written twice.
+ * Returns the number of events converted.
+ */
+long long convertEventsToBinary(const string& inputPath, const string& binaryPath, int threads) {
+    ofstream out(binaryPath, ios::binary);
+    writeBinaryHeader(out, 0);
+    uint64_t count = 0;
+    vector<char> encoded;
+    forEachEventBatch(inputPath, [&](const pair<int, int>* events, size_t batch) {
+        writeBinaryRecords(out, events, batch, encoded);
+        count += batch;
+    }, threads);
+    out.seekp(0);
+    writeBinaryHeader(out, count);
+    if (!out) {
+        error("convertEventsToBinary: could not write " + binaryPath);
+    }
+    return (long long)(count);
+}
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+static void writeText(const string& path, const string& text) {
+    ofstream out(path, ios::binary);
+    out << text;
+}
+
+/* Writes events as CSV with a header line. */
+static void writeEventsCsv(const Vector<pair<int, int>>& events, const string& path) {
+    ofstream out(path);
+    out << "minutes,cost\n";
+    for (const pair<int, int>& event : events) {
+        out << event.first << "," << event.second << "\n";
+    }
+}
+
+STUDENT_TEST("Events stream from CSV and binary files in order") {
+    writeText("events-test.csv", "minutes, cost\r\n40,10\r\n 28 , 7\n\n30,5\n18,2\n15,3\n5,1");
+    Vector<pair<int, int>> expected = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    EXPECT(detectEventFormat("events-test.csv") == EventFormat::Csv);
+    EXPECT(loadEvents("events-test.csv") == expected);
+    EXPECT_EQUAL(maxMinutesFromFile("events-test.csv", 15), 81);
+
+    EXPECT_EQUAL(convertEventsToBinary("events-test.csv", "events-test.bin"), 6);
+    EXPECT(detectEventFormat("events-test.bin") == EventFormat::Binary);
+    EXPECT(loadEvents("events-test.bin") == expected);
+    EXPECT_EQUAL(maxMinutesFromFile("events-test.bin", 15), 81);
+
+    writeText("events-test.csv", "");
+    EXPECT_EQUAL(loadEvents("events-test.csv").size(), 0);
+    EXPECT_EQUAL(maxMinutesFromFile("events-test.csv", 15), 0);
+    writeText("events-test.csv", "40,10\n28;7\n");
+    EXPECT_ERROR(loadEvents("events-test.csv"));
+    writeText("events-test.csv", "40,-10\n");
+    EXPECT_ERROR(loadEvents("events-test.csv"));
+
+    // A signed first line is data, not a header, and is rejected too
+    writeText("events-test.csv", "-5,3\n40,10\n");
+    EXPECT_ERROR(loadEvents("events-test.csv"));
+    writeText("events-test.csv", "+40,10\n28,7\n");
+    EXPECT_ERROR(loadEvents("events-test.csv"));
+    writeText("events-test.csv", "Minutes,Cost\n40,10\n");
+    EXPECT_EQUAL(loadEvents("events-test.csv").size(), 1);
+    EXPECT_ERROR(loadEvents("events-test-missing.csv"));
+    remove("events-test.csv");
+    remove("events-test.bin");
+}
+
+STUDENT_TEST("Streaming DP matches maxMinutesDP across chunk boundaries and row widths") {
+    // Enough lines to span several chunks, so lines straddle the cuts
+    Vector<pair<int, int>> events;
+    for (int i = 0; i < 400000; i++) {
+        events.add({randomInteger(0, 150), randomInteger(0, 3000)});
+    }
+    writeEventsCsv(events, "events-test.csv");
+    writeEventsBinary(events, "events-test.bin");
+    for (int threads = 1; threads <= 4; threads++) {
+        EXPECT(loadEvents("events-test.csv", threads) == events);
+        EXPECT(loadEvents("events-test.bin", threads) == events);
+    }
+    EXPECT_EQUAL(maxMinutesFromFile("events-test.csv", 200), maxMinutesDP(events, 200));
+    EXPECT_EQUAL(maxMinutesFromFile("events-test.bin", 2000, 3), maxMinutesDP(events, 2000));
+
+    // Totals past 16 and 32 bits widen the row mid-stream
+    events = {{60000, 1}, {60000, 1}, {2000000000, 2}, {2000000000, 2}, {2000000000, 3}};
+    writeEventsBinary(events, "events-test.bin");
+    DPArena arena;
+    for (int money = 0; money <= 8; money++) {
+        EXPECT_EQUAL(maxMinutesFromFile("events-test.bin", money), maxMinutesDP(events, money, arena));
+    }
+    remove("events-test.csv");
+    remove("events-test.bin");
+}
+
+/* The old path: build the whole event list, then run the DP on it. */
+static long long loadThenSolve(const string& path, int money) {
+    return maxMinutesDP(loadEvents(path), money);
+}
+
+STUDENT_TEST("Time trials on streaming a catalogue straight into the DP") {
+    Vector<pair<int, int>> events;
+    for (int i = 0; i < 2000000; i++) {
+        events.add({randomInteger(50, 150), randomInteger(0, 3000)});
+    }
+    writeEventsCsv(events, "events-trial.csv");
+    TIME_OPERATION(events.size(), convertEventsToBinary("events-trial.csv", "events-trial.bin"));
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        TIME_OPERATION(threads, loadEvents("events-trial.csv", threads));
+        TIME_OPERATION(threads, loadEvents("events-trial.bin", threads));
+    }
+    TIME_OPERATION(events.size(), loadThenSolve("events-trial.csv", 1000));
+    TIME_OPERATION(events.size(), maxMinutesFromFile("events-trial.csv", 1000));
+    TIME_OPERATION(events.size(), maxMinutesFromFile("events-trial.bin", 1000));
+    remove("events-trial.csv");
+    remove("events-trial.bin");
+}
@@ -0,0 +1,41 @@
+#ifndef EVENTSTREAM_H
+#define EVENTSTREAM_H
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include "vector.h"
+
+/* Event catalogues on disk come in two formats. CSV files hold one
+ * "minutes,cost" line per event, optionally after a header line, which
+ * is told apart from data by containing a letter. Binary files start
+ * with the 4-byte tag "EVT1" and an 8-byte little-endian event count,
+ * followed by that many pairs of little-endian 32-bit minutes and cost.
+ * The format is detected from the tag.
+ */
+enum class EventFormat {
+    Csv,
+    Binary
+};
+
+EventFormat detectEventFormat(const std::string& path);
+
+/* Streams every event in a file to consume, in file order, in batches
+ * that live only until consume returns. The file is memory-mapped and
+ * each batch is parsed by several threads at once into buffers that
+ * are reused from batch to batch. threads <= 0 uses every hardware
+ * thread.
+ */
+void forEachEventBatch(const std::string& path,
+                       const std::function<void(const std::pair<int, int>* events, size_t count)>& consume,
+                       int threads = 0);
+
+Vector<std::pair<int, int>> loadEvents(const std::string& path, int threads = 0);
+long long maxMinutesFromFile(const std::string& path, int money, int threads = 0);
+
+void writeEventsBinary(const Vector<std::pair<int, int>>& events, const std::string& path);
+long long convertEventsToBinary(const std::string& inputPath, const std::string& binaryPath, int threads = 0);
+
+#endif // EVENTSTREAM_H
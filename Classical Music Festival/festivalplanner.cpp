@@ -0,0 +1,264 @@
+#include "festivalplanner.h"
+#include <algorithm>
+#include "dpkernel.h"
+#include "musicevents.h"
+#include "error.h"
+#include "testing/SimpleTest.h"
+
+using namespace std;
+
+/* Row slot 0 of the arena holds the row for every event in order, and
+ * slot k + 1 holds checkpoint k: the row after the first
+ * k * interval events. Checkpoint 0 is therefore always all zeros.
+ * Positions before dirtyFrom have not changed since their checkpoints
+ * were saved. When stale is set, the current row no longer matches the
+ * order, and everything from dirtyFrom onward is refolded on the next
+ * query.
+ */
+
+FestivalPlanner::FestivalPlanner(int maxMoney, int checkpointInterval) {
+    if (maxMoney < 0 || checkpointInterval <= 0) {
+        error("FestivalPlanner: maxMoney must be non-negative and checkpointInterval positive");
+    }
+    budget = maxMoney;
+    interval = checkpointInterval;
+    dirtyFrom = 0;
+    stale = false;
+    totalMinutes = 0;
+    foldCount = 0;
+    uint32_t* current = rows.row<uint32_t>(budget + 1, 0);
+    fill(current, current + budget + 1, 0);
+    uint32_t* start = rows.row<uint32_t>(budget + 1, 1);
+    fill(start, start + budget + 1, 0);
+}
+
+int FestivalPlanner::size() const {
+    return order.size();
+}
+
+int FestivalPlanner::maxMoney() const {
+    return budget;
+}
+
+bool FestivalPlanner::containsEvent(int id) const {
+    return id >= 0 && id < position.size() && position[id] != -1;
+}
+
+pair<int, int> FestivalPlanner::getEvent(int id) const {
+    checkId(id);
+    return events[id];
+}
+
+void FestivalPlanner::checkId(int id) const {
+    if (!containsEvent(id)) {
+        error("FestivalPlanner: no event with id " + to_string(id));
+    }
+}
+
+/* Events folded into a row so far, counting every refold, which is the
+ * work the planner has done.
+ */
+long long FestivalPlanner::folds() const {
+    return foldCount;
+}
+
+void FestivalPlanner::fold(int id, uint32_t* row) {
+    foldCount++;
+    knapsackRowUpdate(row, budget, events[id].second, uint32_t(events[id].first));
+}
+
+/* Appends the event to the order. If nothing is pending, the event is
+ * folded straight into the current row, plus a checkpoint copy when it
+ * completes an interval; otherwise it waits for the next refresh.
+ */
+int FestivalPlanner::addEvent(int minutes, int cost) {
+    if (minutes < 0 || cost < 0) {
+        error("FestivalPlanner: event durations and costs must be non-negative");
+    }
+    if (totalMinutes + minutes > UINT32_MAX) {
+        error("FestivalPlanner: total duration does not fit in the DP row");
+    }
+    int id = events.size();
+    events.add({minutes, cost});
+    position.add(order.size());
+    order.add(id);
+    totalMinutes += minutes;
+    if (!stale) {
+        uint32_t* current = rows.row<uint32_t>(budget + 1, 0);
+        fold(id, current);
+        if (order.size() % interval == 0) {
+            uint32_t* checkpoint = rows.row<uint32_t>(budget + 1, order.size() / interval + 1);
+            copy(current, current + budget + 1, checkpoint);
+        }
+        dirtyFrom = order.size();
+    }
+    return id;
+}
+
+/* Takes the event out of the order and marks everything from its old
+ * position onward as needing a refold.
+ */
+void FestivalPlanner::detach(int id) {
+    int p = position[id];
+    order.remove(p);
+    for (int i = p; i < order.size(); i++) {
+        position[order[i]] = i;
+    }
+    position[id] = -1;
+    totalMinutes -= events[id].first;
+    dirtyFrom = min(dirtyFrom, p);
+    stale = true;
+}
+
+void FestivalPlanner::removeEvent(int id) {
+    checkId(id);
+    detach(id);
+}
+
+/* An updated event keeps its id but moves to the back of the order. */
+void FestivalPlanner::updateEvent(int id, int minutes, int cost) {
+    checkId(id);
+    if (minutes < 0 || cost < 0) {
+        error("FestivalPlanner: event durations and costs must be non-negative");
+    }
+    if (totalMinutes - events[id].first + minutes > UINT32_MAX) {
+        error("FestivalPlanner: total duration does not fit in the DP row");
+    }
+    detach(id);
+    events[id] = {minutes, cost};
+    position[id] = order.size();
+    order.add(id);
+    totalMinutes += minutes;
+}
+
+/* Restarts from the last checkpoint at or before dirtyFrom and refolds
+ * every event after it, saving checkpoints along the way.
+ */
+void FestivalPlanner::refresh() {
+    if (!stale) {
+        return;
+    }
+    int k = dirtyFrom / interval;
+    uint32_t* current = rows.row<uint32_t>(budget + 1, 0);
+    const uint32_t* checkpoint = rows.row<uint32_t>(budget + 1, k + 1);
+    copy(checkpoint, checkpoint + budget + 1, current);
+    for (int i = k * interval; i < order.size(); i++) {
+        fold(order[i], current);
+        if ((i + 1) % interval == 0) {
+            uint32_t* next = rows.row<uint32_t>(budget + 1, (i + 1) / interval + 1);
+            copy(current, current + budget + 1, next);
+        }
+    }
+    dirtyFrom = order.size();
+    stale = false;
+}
+
+long long FestivalPlanner::maxMinutes() {
+    return maxMinutes(budget);
+}
+
+/* Any budget up to maxMoney can be read off the same row. */
+long long FestivalPlanner::maxMinutes(int money) {
+    if (money < 0) {
+        return 0;
+    }
+    if (money > budget) {
+        error("FestivalPlanner: budget is larger than the planner's maxMoney");
+    }
+    refresh();
+    return rows.row<uint32_t>(budget + 1, 0)[money];
+}
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+STUDENT_TEST("FestivalPlanner matches maxMinutesDP through adds, removes and updates") {
+    FestivalPlanner planner(20, 2);
+    int a = planner.addEvent(75, 15);
+    int b = planner.addEvent(9, 3);
+    int c = planner.addEvent(60, 10);
+    int d = planner.addEvent(24, 8);
+    int e = planner.addEvent(10, 1);
+    EXPECT_EQUAL(planner.maxMinutes(), 94);
+    EXPECT_EQUAL(planner.maxMinutes(15), 79);
+
+    planner.removeEvent(a);
+    EXPECT_EQUAL(planner.maxMinutes(), 94);
+    planner.removeEvent(c);
+    EXPECT_EQUAL(planner.maxMinutes(), 43);
+    long long folds = planner.folds();
+    planner.updateEvent(b, 100, 20);
+    EXPECT_EQUAL(planner.maxMinutes(), 100);
+    EXPECT_EQUAL(planner.folds() - folds, 3);
+    EXPECT(planner.getEvent(b) == make_pair(100, 20));
+    EXPECT_EQUAL(planner.size(), 3);
+    EXPECT(!planner.containsEvent(a));
+    EXPECT(planner.containsEvent(d) && planner.containsEvent(e));
+    EXPECT_ERROR(planner.removeEvent(a));
+    EXPECT_ERROR(planner.maxMinutes(21));
+
+    /* A rejected update leaves the event where it was */
+    FestivalPlanner full(3);
+    full.addEvent(2100000000, 1);
+    full.addEvent(2100000000, 1);
+    int last = full.addEvent(90000000, 1);
+    EXPECT_EQUAL(full.maxMinutes(), 4290000000LL);
+    EXPECT_ERROR(full.updateEvent(last, 200000000, 1));
+    EXPECT(full.containsEvent(last));
+    EXPECT(full.getEvent(last) == make_pair(90000000, 1));
+    EXPECT_EQUAL(full.size(), 3);
+    EXPECT_EQUAL(full.maxMinutes(), 4290000000LL);
+
+    for (int interval : {1, 3, 16}) {
+        FestivalPlanner random(500, interval);
+        Vector<int> ids;
+        for (int step = 0; step < 300; step++) {
+            int action = randomInteger(0, 3);
+            if (ids.isEmpty() || action <= 1) {
+                ids.add(random.addEvent(randomInteger(0, 150), randomInteger(0, 100)));
+            }
+            else if (action == 2) {
+                int i = randomInteger(0, ids.size() - 1);
+                random.removeEvent(ids[i]);
+                ids.remove(i);
+            }
+            else {
+                random.updateEvent(ids[randomInteger(0, ids.size() - 1)], randomInteger(0, 150), randomInteger(0, 100));
+            }
+            if (step % 7 == 0) {
+                Vector<pair<int, int>> live;
+                for (int id : ids) {
+                    live.add(random.getEvent(id));
+                }
+                int money = randomInteger(0, 500);
+                EXPECT_EQUAL(random.maxMinutes(money), maxMinutesDP(live, money));
+            }
+        }
+    }
+}
+
+STUDENT_TEST("Time trials comparing FestivalPlanner changes against rerunning maxMinutesDP") {
+    int money = 100000;
+    FestivalPlanner planner(money);
+    Vector<pair<int, int>> musicEvents;
+    Vector<int> ids;
+    for (int i = 0; i < 2000; i++) {
+        int time = randomInteger(50, 150);
+        int cost = randomInteger(0, 3000);
+        musicEvents.add({time, cost});
+        ids.add(planner.addEvent(time, cost));
+    }
+    TIME_OPERATION(musicEvents.size(), maxMinutesDP(musicEvents, money));
+    TIME_OPERATION(musicEvents.size(), planner.maxMinutes());
+    // A new event, then repeated repricing of that same event
+    int late = planner.addEvent(120, 500);
+    TIME_OPERATION(1, planner.maxMinutes());
+    for (int i = 0; i < 3; i++) {
+        planner.updateEvent(late, randomInteger(50, 150), randomInteger(0, 3000));
+        TIME_OPERATION(1, planner.maxMinutes());
+    }
+    // Cancelling events from the middle and from the start of the order
+    planner.removeEvent(ids[1000]);
+    TIME_OPERATION(1000, planner.maxMinutes());
+    planner.removeEvent(ids[0]);
+    TIME_OPERATION(2000, planner.maxMinutes());
+}
@@ -0,0 +1,56 @@
+#ifndef FESTIVALPLANNER_H
+#define FESTIVALPLANNER_H
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include "vector.h"
+#include "dparena.h"
+
+/* A stateful version of maxMinutesDP for lineups that change over time.
+ * Events are folded into the DP row in a fixed order, and a copy of the
+ * row is kept every checkpointInterval events. Adding an event folds it
+ * into the current row in O(money). Removing or updating an event
+ * refolds every event after the checkpoint just before it, so the cost
+ * depends on where the event sits in the order: near the back it is a
+ * few folds, but near the front it is a full rebuild from checkpoint 0,
+ * no cheaper than rerunning maxMinutesDP. An updated event moves to the
+ * back of the order, so events that keep changing are cheap to change
+ * again. Changes are applied lazily, so a batch of them between two
+ * queries costs one refold, from the earliest position changed.
+ */
+class FestivalPlanner {
+public:
+    explicit FestivalPlanner(int maxMoney, int checkpointInterval = 64);
+
+    int addEvent(int minutes, int cost);
+    void removeEvent(int id);
+    void updateEvent(int id, int minutes, int cost);
+    bool containsEvent(int id) const;
+    std::pair<int, int> getEvent(int id) const;
+
+    int size() const;
+    int maxMoney() const;
+    long long maxMinutes();
+    long long maxMinutes(int money);
+    long long folds() const;
+
+private:
+    void checkId(int id) const;
+    void detach(int id);
+    void fold(int id, uint32_t* row);
+    void refresh();
+
+    int budget;
+    int interval;
+    Vector<std::pair<int, int>> events;
+    Vector<int> position;
+    Vector<int> order;
+    int dirtyFrom;
+    bool stale;
+    long long totalMinutes;
+    long long foldCount;
+    DPArena rows;
+};
+
+#endif // FESTIVALPLANNER_H
@@ -1,6 +1,11 @@
 #include "musicevents.h"
 #include <cstring>
-#include "testing/MemoryDiagnostics.h"
+#include <atomic>
+#include <climits>
+#include <vector>
+#include "dpkernel.h"
+#include "threadpool.h"
+#include "error.h"
 #include "testing/SimpleTest.h"
 #include "testing/TestDriver.h"
 #include "testing/TextUtils.h"
@@ -95,8 +100,8 @@ int maxMinutesMemo(Vector<pair<int, int>> events, int money) {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 /** Third (Best) Approach: Bottom-Up Dynamic Programming
- *  Time Complexity: O(m*n)
- *  Space Complexity: O(2*m)
+ *  Time Complexity: O(m*n/w), w is the number of SIMD lanes
+ *  Space Complexity: O(m)
  **/
 
 /* Main DP function that most efficiently takes advantage
@@ -105,32 +110,1226 @@ int maxMinutesMemo(Vector<pair<int, int>> events, int money) {
  * computes the maximum total number of minutes across all
  * subsets of events 0,1,...,i-1 with total cost at most m.
  * This function satisfies the recursive definition
- * f(i, m) = 0, if i == 0 or j == 0,
+ * f(i, m) = 0, if i == 0,
  * f(i, m) = max(f(i - 1, m - "cost of ith event") +
- *                          "duration of ith event", f(i - 1, m), if "cost of ith event" <= i,
+ *                          "duration of ith event", f(i - 1, m), if "cost of ith event" <= m,
  * f(i, m) = f(i - 1, m), otherwise
+ *
+ * Only one row of the table is kept. Each event is folded into it in
+ * place by knapsackRowUpdate, which sweeps the budget axis from the
+ * top down and picks an SSE4.1, AVX2 or AVX-512 kernel at runtime.
+ * The row comes from a DPArena rather than the stack, so large
+ * budgets cannot overflow the stack and repeated calls with the same
+ * budget reuse the same buffer.
  */
 
+template <typename T>
+T maxMinutesDPTyped(const Vector<pair<int, int>>& events, int money, DPArena& arena) {
+    if (money < 0) {
+        return 0;
+    }
+    T* row = arena.row<T>(money + 1);
+    fill(row, row + money + 1, T(0));
+    for (const pair<int, int>& event : events) {
+        knapsackRowUpdate(row, money, event.second, T(event.first));
+    }
+    return row[money];
+}
+
+template uint16_t maxMinutesDPTyped<uint16_t>(const Vector<pair<int, int>>&, int, DPArena&);
+template uint32_t maxMinutesDPTyped<uint32_t>(const Vector<pair<int, int>>&, int, DPArena&);
+template uint64_t maxMinutesDPTyped<uint64_t>(const Vector<pair<int, int>>&, int, DPArena&);
+
+/* Sums the durations of the events that could fit in the budget at
+ * all, which bounds every entry of the DP row. The solvers use it to
+ * choose the row type: uint16_t rows hold twice as many SIMD lanes as
+ * uint32_t rows, and uint64_t is only needed once the total no longer
+ * fits in 32 bits.
+ */
+
+static void checkEvents(const Vector<pair<int, int>>& events) {
+    for (const pair<int, int>& event : events) {
+        if (event.first < 0 || event.second < 0) {
+            error("maxMinutes: event durations and costs must be non-negative");
+        }
+    }
+}
+
+static long long affordableMinutes(const Vector<pair<int, int>>& events, int money) {
+    checkEvents(events);
+    long long total = 0;
+    for (const pair<int, int>& event : events) {
+        if (event.second <= money) {
+            total += event.first;
+        }
+    }
+    return total;
+}
+
+long long maxMinutesDP(const Vector<pair<int, int>>& events, int money, DPArena& arena) {
+    long long total = affordableMinutes(events, money);
+    if (total <= UINT16_MAX) {
+        return maxMinutesDPTyped<uint16_t>(events, money, arena);
+    }
+    if (total <= UINT32_MAX) {
+        return maxMinutesDPTyped<uint32_t>(events, money, arena);
+    }
+    return maxMinutesDPTyped<uint64_t>(events, money, arena);
+}
+
+/* Original interface, kept as a thin wrapper around a per-thread arena. */
+
 int maxMinutesDP(Vector<pair<int, int>> events, int money) {
-    int dp[2][money + 1];
-    memset(dp, 0, sizeof(dp));
-    for (int i = 0; i <= events.size(); i++) {
-        for (int j = 0; j <= money; j++) {
-            if (i == 0 || j == 0) {
+    static thread_local DPArena arena;
+    return int(maxMinutesDP(events, money, arena));
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Fourth Approach: Parallel Bottom-Up Dynamic Programming
+ *  Time Complexity: O(m*n/(w*p)), p is the number of threads
+ *  Space Complexity: O(2*m)
+ **/
+
+/* Each row of the table depends only on the previous row, so the
+ * budget axis 0..money is cut into p contiguous chunks and every
+ * thread fills in its own chunk of row i from row i - 1, with one
+ * barrier per event to make sure the whole of row i - 1 is finished
+ * before anyone reads it. Since a thread's reads reach into other
+ * threads' chunks, the update can no longer happen in place, so two
+ * rows alternate as source and destination.
+ *
+ * Chunks are rounded to whole cache lines so that neighbouring threads
+ * never write to the same line, and thread t of the shared pool always
+ * owns chunk t. The owner also zeroes its chunk before the first event,
+ * so on a NUMA machine the pages it works on are first touched, and
+ * therefore placed, on its own node. Budgets too small to give every
+ * thread at least MIN_PARALLEL_CHUNK entries use fewer threads, and a
+ * single thread falls back to the in-place sequential DP.
+ */
+
+static const int MIN_PARALLEL_CHUNK = 4096;
+
+template <typename T>
+T maxMinutesDPParallelTyped(const Vector<pair<int, int>>& events, int money, int threads, DPArena& arena) {
+    if (money < 0) {
+        return 0;
+    }
+    Vector<pair<int, int>> affordable;
+    for (const pair<int, int>& event : events) {
+        if (event.second <= money) {
+            affordable.add(event);
+        }
+    }
+    int length = money + 1;
+    int lineWidth = int(DPArena::CACHE_LINE / sizeof(T));
+    if (threads <= 0) {
+        threads = ThreadPool::hardwareThreads();
+    }
+    threads = max(1, min(threads, length / MIN_PARALLEL_CHUNK));
+    if (threads == 1) {
+        return maxMinutesDPTyped<T>(events, money, arena);
+    }
+    int chunk = ((length + threads - 1) / threads + lineWidth - 1) / lineWidth * lineWidth;
+
+    T* rows[2] = {arena.row<T>(length, 0), arena.row<T>(length, 1)};
+    SpinBarrier barrier(threads);
+    ThreadPool::shared().run(threads, [&](int t) {
+        int lo = min(length, t * chunk);
+        int hi = min(length, lo + chunk);
+        fill(rows[0] + lo, rows[0] + hi, T(0));
+        fill(rows[1] + lo, rows[1] + hi, T(0));
+        T* in = rows[0];
+        T* out = rows[1];
+        for (const pair<int, int>& event : affordable) {
+            barrier.wait();
+            knapsackRangeUpdate(in, out, lo, hi, event.second, T(event.first));
+            swap(in, out);
+        }
+    });
+    return rows[affordable.size() % 2][money];
+}
+
+template uint16_t maxMinutesDPParallelTyped<uint16_t>(const Vector<pair<int, int>>&, int, int, DPArena&);
+template uint32_t maxMinutesDPParallelTyped<uint32_t>(const Vector<pair<int, int>>&, int, int, DPArena&);
+template uint64_t maxMinutesDPParallelTyped<uint64_t>(const Vector<pair<int, int>>&, int, int, DPArena&);
+
+long long maxMinutesDPParallel(const Vector<pair<int, int>>& events, int money, int threads, DPArena& arena) {
+    long long total = affordableMinutes(events, money);
+    if (total <= UINT16_MAX) {
+        return maxMinutesDPParallelTyped<uint16_t>(events, money, threads, arena);
+    }
+    if (total <= UINT32_MAX) {
+        return maxMinutesDPParallelTyped<uint32_t>(events, money, threads, arena);
+    }
+    return maxMinutesDPParallelTyped<uint64_t>(events, money, threads, arena);
+}
+
+/* Wrapper with the same shape as maxMinutesDP; threads <= 0 uses every
+ * hardware thread.
+ */
+
+int maxMinutesDPParallel(Vector<pair<int, int>> events, int money, int threads) {
+    static thread_local DPArena arena;
+    return int(maxMinutesDPParallel(events, money, threads, arena));
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Fifth Approach: Optimal Selection by Divide and Conquer
+ *  Time Complexity: O(m*n), about twice the work of maxMinutesDP
+ *  Space Complexity: O(m)
+ **/
+
+/* The DP above only keeps one row, which is enough for the total but
+ * not for recovering which events were chosen; keeping every row the
+ * way the memo table does costs O(m*n). Instead, as in Hirschberg's
+ * algorithm, the events are split in half and a forward row is built
+ * for the left half and another for the right half, both over the full
+ * budget. Any optimal selection spends some b on the left and at most
+ * money - b on the right, so the b maximizing left[b] + right[money - b]
+ * tells us how to divide the budget, and each half is solved
+ * recursively with its share. The two rows are no longer needed once b
+ * is known, so the whole recursion shares the same two buffers.
+ * Each level of the recursion does at most m*n work in total, and the
+ * budgets of the two halves sum to the parent's, so the total cost is
+ * about twice a single DP pass.
+ *
+ * If every event in the range fits in the budget together, they are
+ * all taken without building any rows.
+ */
+
+template <typename T>
+static void selectEvents(const Vector<pair<int, int>>& events, int lo, int hi, int money,
+                         T* left, T* right, Vector<int>& chosen) {
+    long long totalCost = 0;
+    for (int i = lo; i < hi; i++) {
+        totalCost += events[i].second;
+    }
+    if (totalCost <= money) {
+        for (int i = lo; i < hi; i++) {
+            if (events[i].first > 0) {
+                chosen.add(i);
+            }
+        }
+        return;
+    }
+    if (hi - lo == 1) {
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    fill(left, left + money + 1, T(0));
+    fill(right, right + money + 1, T(0));
+    for (int i = lo; i < mid; i++) {
+        knapsackRowUpdate(left, money, events[i].second, T(events[i].first));
+    }
+    for (int i = mid; i < hi; i++) {
+        knapsackRowUpdate(right, money, events[i].second, T(events[i].first));
+    }
+    int split = 0;
+    T best = 0;
+    for (int b = 0; b <= money; b++) {
+        T total = T(left[b] + right[money - b]);
+        if (total > best) {
+            best = total;
+            split = b;
+        }
+    }
+    selectEvents(events, lo, mid, split, left, right, chosen);
+    selectEvents(events, mid, hi, money - split, left, right, chosen);
+}
+
+template <typename T>
+static Vector<int> selectEventsTyped(const Vector<pair<int, int>>& events, int money, DPArena& arena) {
+    Vector<int> chosen;
+    if (money < 0 || events.isEmpty()) {
+        return chosen;
+    }
+    T* left = arena.row<T>(money + 1, 0);
+    T* right = arena.row<T>(money + 1, 1);
+    selectEvents(events, 0, events.size(), money, left, right, chosen);
+    return chosen;
+}
+
+/* Returns the indices, in increasing order, of a set of events with
+ * total cost at most money and the largest possible total duration.
+ */
+
+Vector<int> maxMinutesWithSelection(const Vector<pair<int, int>>& events, int money, DPArena& arena) {
+    long long total = affordableMinutes(events, money);
+    if (total <= UINT16_MAX) {
+        return selectEventsTyped<uint16_t>(events, money, arena);
+    }
+    if (total <= UINT32_MAX) {
+        return selectEventsTyped<uint32_t>(events, money, arena);
+    }
+    return selectEventsTyped<uint64_t>(events, money, arena);
+}
+
+Vector<int> maxMinutesWithSelection(const Vector<pair<int, int>>& events, int money) {
+    static thread_local DPArena arena;
+    return maxMinutesWithSelection(events, money, arena);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Sixth Approach: Meet in the Middle
+ *  Time Complexity: O(n*2^(n/2)), independent of the budget
+ *  Space Complexity: O(2^(n/2))
+ **/
+
+/* A frontier lists the useful subsets of some events as (cost, minutes)
+ * pairs sorted by cost. Subsets over budget are dropped, and so is any
+ * subset that costs at least as much as another one without giving
+ * more minutes, so the minutes strictly increase along the list.
+ *
+ * This helper function adds one event to a frontier by merging it with
+ * a copy of itself shifted by the event's cost and duration. Both
+ * copies are already sorted, so every step is a linear merge and no
+ * sorting is ever needed. The scratch vector is reused between calls.
+ */
+
+typedef vector<pair<long long, long long>> Frontier;
+
+static void addToFrontier(Frontier& frontier, Frontier& merged, long long cost, long long minutes,
+                          long long money) {
+    merged.clear();
+    merged.reserve(frontier.size() * 2);
+    size_t a = 0;
+    size_t b = 0;
+    while (a < frontier.size() || b < frontier.size()) {
+        pair<long long, long long> next;
+        if (b == frontier.size() || (a < frontier.size() && frontier[a].first <= frontier[b].first + cost)) {
+            next = frontier[a++];
+        }
+        else {
+            next = {frontier[b].first + cost, frontier[b].second + minutes};
+            b++;
+        }
+        if (next.first > money) {
+            if (a == frontier.size()) {
+                break;
+            }
+            continue;
+        }
+        if (merged.empty() || next.second > merged.back().second) {
+            if (!merged.empty() && merged.back().first == next.first) {
+                merged.pop_back();
+            }
+            merged.push_back(next);
+        }
+    }
+    frontier.swap(merged);
+}
+
+/* Builds the frontier of events lo..hi-1, starting from the empty subset. */
+
+static Frontier subsetFrontier(const Vector<pair<int, int>>& events, int lo, int hi, long long money) {
+    Frontier frontier = {{0, 0}};
+    Frontier merged;
+    for (int i = lo; i < hi; i++) {
+        addToFrontier(frontier, merged, events[i].second, events[i].first, money);
+    }
+    return frontier;
+}
+
+/* Horowitz-Sahni: the events are split in half, and the frontier of
+ * each half is built with the helper above. For each subset of the
+ * first half, taken in order of increasing cost, the best partner from
+ * the second half is the last entry that still fits in what remains of
+ * the budget. That pointer only ever moves down, so the merge is one
+ * linear two-pointer sweep. The budget is a long long, since this
+ * solver never allocates anything proportional to it.
+ */
+
+long long maxMinutesMeetInMiddle(const Vector<pair<int, int>>& events, long long money) {
+    if (money < 0) {
+        return 0;
+    }
+    checkEvents(events);
+    int mid = events.size() / 2;
+    Frontier first = subsetFrontier(events, 0, mid, money);
+    Frontier second = subsetFrontier(events, mid, events.size(), money);
+    long long best = 0;
+    int j = int(second.size()) - 1;
+    for (const pair<long long, long long>& subset : first) {
+        while (j >= 0 && subset.first + second[j].first > money) {
+            j--;
+        }
+        if (j < 0) {
+            break;
+        }
+        best = max(best, subset.second + second[j].second);
+    }
+    return best;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Seventh Approach: Sparse Pareto Frontier
+ *  Time Complexity: O(n*F), F is the largest frontier size
+ *  Space Complexity: O(F)
+ **/
+
+/* Builds the frontier of all the events at once. Its last entry is the
+ * most minutes that fit in the budget, and its size never exceeds
+ * either money + 1 or the number of distinct totals of minutes, so for
+ * large, irregular prices it is usually far shorter than a DP row.
+ */
+
+long long maxMinutesPareto(const Vector<pair<int, int>>& events, long long money, long long& entries) {
+    entries = 0;
+    if (money < 0) {
+        return 0;
+    }
+    checkEvents(events);
+    Frontier frontier = {{0, 0}};
+    Frontier merged;
+    for (const pair<int, int>& event : events) {
+        addToFrontier(frontier, merged, event.second, event.first, money);
+        entries += frontier.size();
+    }
+    return frontier.back().second;
+}
+
+long long maxMinutesPareto(const Vector<pair<int, int>>& events, long long money) {
+    long long entries;
+    return maxMinutesPareto(events, money, entries);
+}
+
+/* The planner estimates the dense DP's cost as one unit per cell of
+ * the table, using only the events that fit in the budget, and the
+ * frontier engine's as DENSE_CELLS_PER_FRONTIER_ENTRY units per frontier
+ * entry merged; the vector kernel streams many cells in the time one
+ * merge step takes to branch. It starts on the frontier, since
+ * the frontier's growth cannot be predicted from n and money alone, and
+ * hands over to the dense DP as soon as the merges so far have cost
+ * more than the whole dense pass would. Budgets too large for a DP row
+ * always stay on the frontier.
+ */
+
+static const long long DENSE_CELLS_PER_FRONTIER_ENTRY = 32;
+
+long long maxMinutesAuto(const Vector<pair<int, int>>& events, long long money, KnapsackEngine& engine) {
+    engine = KnapsackEngine::Pareto;
+    if (money < 0) {
+        return 0;
+    }
+    checkEvents(events);
+    long long denseWork = LLONG_MAX;
+    if (money < INT_MAX) {
+        long long affordable = 0;
+        for (const pair<int, int>& event : events) {
+            if (event.second <= money) {
+                affordable++;
+            }
+        }
+        denseWork = affordable * (money + 1);
+    }
+    Frontier frontier = {{0, 0}};
+    Frontier merged;
+    long long frontierWork = 0;
+    for (const pair<int, int>& event : events) {
+        addToFrontier(frontier, merged, event.second, event.first, money);
+        frontierWork += (long long)(frontier.size()) * DENSE_CELLS_PER_FRONTIER_ENTRY;
+        if (frontierWork > denseWork) {
+            engine = KnapsackEngine::Dense;
+            static thread_local DPArena arena;
+            return maxMinutesDP(events, int(money), arena);
+        }
+    }
+    return frontier.back().second;
+}
+
+long long maxMinutesAuto(const Vector<pair<int, int>>& events, long long money) {
+    KnapsackEngine engine;
+    return maxMinutesAuto(events, money, engine);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Eighth Approach: Parallel Branch and Bound
+ *  Time Complexity: O(2^n) in the worst case, far less once pruning bites
+ *  Space Complexity: O(n) per thread
+ **/
+
+/* The exact search the backtracking approach performs, for budgets too
+ * large for a DP row, without its per-call copy of the events and with
+ * most of its subsets pruned. Events are sorted by minutes per dollar,
+ * so the best a partial selection could still reach is bounded by
+ * filling the remaining money greedily in that order and taking a
+ * fraction of the first event that does not fit. The whole events of
+ * that greedy fill are themselves a valid selection, so every bound
+ * computed also offers a candidate for the incumbent best. A subtree
+ * whose bound cannot beat the incumbent is never entered.
+ */
+
+struct BoundEvent {
+    long long minutes;
+    long long cost;
+};
+
+struct BranchNode {
+    int index;
+    long long money;
+    long long minutes;
+};
+
+/* Each worker counts its nodes on its own cache line. */
+struct alignas(64) NodeCount {
+    long long nodes = 0;
+};
+
+struct BranchSearch {
+    vector<BoundEvent> events;
+    vector<long long> prefixMinutes;
+    vector<long long> prefixCost;
+    atomic<long long> best;
+    WorkStealingQueue<BranchNode>* queue = nullptr;
+    int splitDepth = 0;
+    vector<NodeCount> counts;
+};
+
+/* Subtrees are only handed to other threads near the root, and only
+ * while this thread's own deque is short, so the locking stays
+ * negligible next to the searching.
+ */
+static const size_t MAX_SPLIT_BACKLOG = 4;
+
+static void offerBest(BranchSearch& search, long long minutes) {
+    long long best = search.best.load(memory_order_relaxed);
+    while (minutes > best && !search.best.compare_exchange_weak(best, minutes, memory_order_relaxed)) {}
+}
+
+/* Greedy fill from index with the money left: returns the fractional
+ * bound and offers the whole-event part as a candidate.
+ */
+static long long fractionalBound(BranchSearch& search, const BranchNode& node) {
+    const vector<long long>& cost = search.prefixCost;
+    int k = int(upper_bound(cost.begin() + node.index, cost.end(), cost[node.index] + node.money) - cost.begin()) - 1;
+    long long whole = node.minutes + search.prefixMinutes[k] - search.prefixMinutes[node.index];
+    offerBest(search, whole);
+    if (k == int(search.events.size())) {
+        return whole;
+    }
+    long long left = node.money - (cost[k] - cost[node.index]);
+    return whole + left * search.events[k].minutes / search.events[k].cost;
+}
+
+/* Takes the event at each level first, since the ratio order makes that
+ * the likelier branch to raise the incumbent early, and walks the skip
+ * branch in the same loop, so only the take branches use the stack.
+ */
+static void branch(BranchSearch& search, int worker, BranchNode node) {
+    while (node.index < int(search.events.size())) {
+        search.counts[worker].nodes++;
+        if (fractionalBound(search, node) <= search.best.load(memory_order_relaxed)) {
+            return;
+        }
+        const BoundEvent& event = search.events[node.index];
+        BranchNode skip = {node.index + 1, node.money, node.minutes};
+        if (event.cost <= node.money) {
+            BranchNode take = {node.index + 1, node.money - event.cost, node.minutes + event.minutes};
+            if (search.queue != nullptr && node.index < search.splitDepth &&
+                search.queue->backlog(worker) < MAX_SPLIT_BACKLOG) {
+                search.queue->push(worker, skip);
+                node = take;
+                continue;
+            }
+            branch(search, worker, take);
+        }
+        node = skip;
+    }
+    offerBest(search, node.minutes);
+}
+
+/* Events over budget can never be chosen and are dropped; free events
+ * are always worth taking and are added up front, which also keeps
+ * every cost in the ratio order positive. With one thread the search
+ * runs directly on the caller; otherwise the root goes on a
+ * work-stealing queue over the shared pool and the threads share the
+ * incumbent through an atomic.
+ */
+long long maxMinutesBranchAndBound(const Vector<pair<int, int>>& events, long long money, int threads,
+                                   long long& nodes) {
+    nodes = 0;
+    if (money < 0) {
+        return 0;
+    }
+    checkEvents(events);
+    BranchSearch search;
+    long long freeMinutes = 0;
+    for (const pair<int, int>& event : events) {
+        if (event.second == 0) {
+            freeMinutes += event.first;
+        }
+        else if (event.second <= money) {
+            search.events.push_back({event.first, event.second});
+        }
+    }
+    sort(search.events.begin(), search.events.end(), [](const BoundEvent& a, const BoundEvent& b) {
+        return a.minutes * b.cost > b.minutes * a.cost;
+    });
+    search.prefixMinutes.assign(1, 0);
+    search.prefixCost.assign(1, 0);
+    for (const BoundEvent& event : search.events) {
+        search.prefixMinutes.push_back(search.prefixMinutes.back() + event.minutes);
+        search.prefixCost.push_back(search.prefixCost.back() + event.cost);
+    }
+    search.best = 0;
+
+    if (threads <= 0) {
+        threads = ThreadPool::hardwareThreads();
+    }
+    BranchNode root = {0, money, 0};
+    if (threads == 1 || search.events.size() < 2) {
+        search.counts.resize(1);
+        branch(search, 0, root);
+        nodes = search.counts[0].nodes;
+        return freeMinutes + search.best;
+    }
+    search.counts.resize(threads);
+    WorkStealingQueue<BranchNode> queue(threads);
+    search.queue = &queue;
+    search.splitDepth = min(int(search.events.size()), 2 * int(log2(threads)) + 12);
+    queue.push(0, root);
+    queue.run(ThreadPool::shared(), [&](int worker, BranchNode& node) {
+        branch(search, worker, node);
+    });
+    for (const NodeCount& count : search.counts) {
+        nodes += count.nodes;
+    }
+    return freeMinutes + search.best;
+}
+
+long long maxMinutesBranchAndBound(const Vector<pair<int, int>>& events, long long money, int threads) {
+    long long nodes;
+    return maxMinutesBranchAndBound(events, money, threads, nodes);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Ninth Approach: Iterative Top-Down with a Sparse Memo
+ *  Time Complexity: O(s), s is the number of states reached, at most m*n
+ *  Space Complexity: O(s)
+ **/
+
+/* The same recurrence as the memoized approach, evaluated with an
+ * explicit stack so deep inputs cannot overflow the call stack, and
+ * with a hash memo that stores only the (index, money) states actually
+ * reached instead of a full n by (money + 1) grid. Once the remaining
+ * events all fit in the money left, their total is the answer for that
+ * state, so whole subtrees finish in O(1) from suffix sums without
+ * touching the memo. The budget is a long long, since nothing here is
+ * proportional to it.
+ */
+
+/* Open-addressing table from (index, money) to the best minutes, with
+ * linear probing over a power-of-two capacity that doubles at half
+ * load. Slots with index -1 are empty; nothing is ever erased.
+ */
+class StateMemo {
+public:
+    StateMemo() : slots(INITIAL_CAPACITY), used(0) {}
+
+    bool find(int index, long long money, long long& minutes) const {
+        for (size_t at = slotFor(index, money, slots.size());; at = (at + 1) & (slots.size() - 1)) {
+            const Slot& slot = slots[at];
+            if (slot.index == -1) {
+                return false;
+            }
+            if (slot.index == index && slot.money == money) {
+                minutes = slot.minutes;
+                return true;
+            }
+        }
+    }
+
+    void insert(int index, long long money, long long minutes) {
+        if (2 * (used + 1) > slots.size()) {
+            rehash(slots.size() * 2);
+        }
+        place(slots, {money, minutes, index});
+        used++;
+    }
+
+    size_t size() const {
+        return used;
+    }
+
+    size_t bytes() const {
+        return slots.size() * sizeof(Slot);
+    }
+
+private:
+    struct Slot {
+        long long money;
+        long long minutes;
+        int index = -1;
+    };
+
+    static const size_t INITIAL_CAPACITY = 64;
+
+    static size_t slotFor(int index, long long money, size_t capacity) {
+        uint64_t key = uint64_t(money) * 0x9E3779B97F4A7C15ULL ^ uint64_t(index) * 0xC2B2AE3D27D4EB4FULL;
+        key ^= key >> 29;
+        return size_t(key) & (capacity - 1);
+    }
+
+    static void place(vector<Slot>& table, const Slot& entry) {
+        size_t at = slotFor(entry.index, entry.money, table.size());
+        while (table[at].index != -1) {
+            at = (at + 1) & (table.size() - 1);
+        }
+        table[at] = entry;
+    }
+
+    void rehash(size_t capacity) {
+        vector<Slot> grown(capacity);
+        for (const Slot& slot : slots) {
+            if (slot.index != -1) {
+                place(grown, slot);
+            }
+        }
+        slots.swap(grown);
+    }
+
+    vector<Slot> slots;
+    size_t used;
+};
+
+/* Each stack frame is a state whose value is not yet known. A frame
+ * pushes whichever of its two successors is still missing, and is only
+ * resolved once both are in the memo (or finish on their own), so each
+ * state is evaluated exactly once.
+ */
+
+struct TopDownFrame {
+    int index;
+    long long money;
+};
+
+long long maxMinutesTopDown(const Vector<pair<int, int>>& events, long long money, TopDownStats& stats) {
+    stats = TopDownStats();
+    if (money < 0) {
+        return 0;
+    }
+    checkEvents(events);
+    int n = events.size();
+    vector<long long> suffixMinutes(n + 1, 0);
+    vector<long long> suffixCost(n + 1, 0);
+    for (int i = n - 1; i >= 0; i--) {
+        suffixMinutes[i] = suffixMinutes[i + 1] + events[i].first;
+        suffixCost[i] = suffixCost[i + 1] + events[i].second;
+    }
+    StateMemo memo;
+    auto known = [&](int index, long long left, long long& minutes) {
+        if (suffixCost[index] <= left) {
+            minutes = suffixMinutes[index];
+            return true;
+        }
+        return memo.find(index, left, minutes);
+    };
+
+    long long answer = 0;
+    if (known(0, money, answer)) {
+        return answer;
+    }
+    vector<TopDownFrame> stack = {{0, money}};
+    while (!stack.empty()) {
+        TopDownFrame frame = stack.back();
+        const pair<int, int>& event = events[frame.index];
+        long long skip = 0;
+        if (!known(frame.index + 1, frame.money, skip)) {
+            stack.push_back({frame.index + 1, frame.money});
+            continue;
+        }
+        long long best = skip;
+        if (event.second <= frame.money) {
+            long long take = 0;
+            if (!known(frame.index + 1, frame.money - event.second, take)) {
+                stack.push_back({frame.index + 1, frame.money - event.second});
                 continue;
             }
-            else if (events[i - 1].second <= j) {
-                dp[1][j] = max(dp[0][j - events[i - 1].second] + events[i - 1].first, dp[0][j]);
+            best = max(best, take + event.first);
+        }
+        memo.insert(frame.index, frame.money, best);
+        stack.pop_back();
+    }
+    memo.find(0, money, answer);
+    stats.states = memo.size();
+    stats.memoBytes = memo.bytes();
+    return answer;
+}
+
+long long maxMinutesTopDown(const Vector<pair<int, int>>& events, long long money) {
+    TopDownStats stats;
+    return maxMinutesTopDown(events, money, stats);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Tenth Approach: Budget and Time Limits
+ *  Time Complexity: O(m*h*n/(w*p)), h is the time limit in minutes
+ *  Space Complexity: O(m*h), doubled when running in parallel
+ **/
+
+/* Attendees who also have only so many hours need a second capacity
+ * axis: f(i, m, t) is the most minutes from events 0..i-1 with total
+ * cost at most m and total duration at most t, so each event folds
+ * into a (money + 1) by (60 * hours + 1) table with
+ * f(i, m, t) = max(f(i - 1, m, t),
+ *                  f(i - 1, m - cost, t - duration) + duration).
+ * Every entry is at most t, so the table is uint16_t whenever the time
+ * limit allows, which doubles the SIMD lanes as in the 1D solvers.
+ *
+ * Row m only reads row m - cost, so with a single thread the table is
+ * updated in place, sweeping the rows from the top down with the
+ * shift-max kernel (or the 1D row kernel for free events). Rows are
+ * padded to whole cache lines.
+ *
+ * In parallel, a thread's reads reach into rows other threads write,
+ * so as in the parallel 1D DP two tables alternate with one barrier
+ * per event. The table is cut into tiles of TILE_ROWS rows by
+ * TILE_COLUMNS columns, and thread t always owns the same contiguous
+ * run of tiles, which it also zeroes first. Each row strip of a tile is
+ * copied and then maxed with the shifted strip of row m - cost while
+ * it is still in L1, so the out-of-place update costs little more than
+ * the in-place one. The dependence of each event on the one before
+ * rules out blocking across events, so every event still streams the
+ * whole table once.
+ */
+
+static const int TILE_ROWS = 16;
+static const int TILE_COLUMNS = 2048;
+
+template <typename T>
+static T maxMinutesDP2DTyped(const Vector<pair<int, int>>& events, int money, int limit, int threads,
+                             DPArena& arena) {
+    int lineWidth = int(DPArena::CACHE_LINE / sizeof(T));
+    int stride = (limit + 1 + lineWidth - 1) / lineWidth * lineWidth;
+    long long cells = (long long)(money + 1) * stride;
+    if (cells > INT_MAX) {
+        error("maxMinutesDP2D: budget and time limit give too large a table");
+    }
+    threads = int(max(1LL, min((long long)(threads), cells / MIN_PARALLEL_CHUNK)));
+
+    if (threads == 1) {
+        T* table = arena.row<T>(int(cells));
+        fill(table, table + cells, T(0));
+        for (const pair<int, int>& event : events) {
+            T duration = T(event.first);
+            for (int m = money; m >= event.second; m--) {
+                T* row = table + (long long)(m) * stride;
+                if (event.second == 0) {
+                    knapsackRowUpdate(row, limit, event.first, duration);
+                }
+                else {
+                    knapsackShiftMax(row - (long long)(event.second) * stride, row, 0, limit + 1,
+                                     event.first, duration);
+                }
             }
-            else {
-                dp[1][j] = dp[0][j];
+        }
+        return table[(long long)(money) * stride + limit];
+    }
+
+    int rowTiles = (money + TILE_ROWS) / TILE_ROWS;
+    int columnTiles = (limit + TILE_COLUMNS) / TILE_COLUMNS;
+    int tiles = rowTiles * columnTiles;
+    threads = min(threads, tiles);
+    T* tables[2] = {arena.row<T>(int(cells), 0), arena.row<T>(int(cells), 1)};
+    SpinBarrier barrier(threads);
+    ThreadPool::shared().run(threads, [&](int t) {
+        int first = int((long long)(tiles) * t / threads);
+        int last = int((long long)(tiles) * (t + 1) / threads);
+        auto forEachStrip = [&](auto&& visit) {
+            for (int tile = first; tile < last; tile++) {
+                int m0 = tile / columnTiles * TILE_ROWS;
+                int c0 = tile % columnTiles * TILE_COLUMNS;
+                int m1 = min(money + 1, m0 + TILE_ROWS);
+                int c1 = min(limit + 1, c0 + TILE_COLUMNS);
+                for (int m = m0; m < m1; m++) {
+                    visit(m, c0, c1);
+                }
             }
+        };
+        forEachStrip([&](int m, int c0, int c1) {
+            fill(tables[0] + (long long)(m) * stride + c0, tables[0] + (long long)(m) * stride + c1, T(0));
+            fill(tables[1] + (long long)(m) * stride + c0, tables[1] + (long long)(m) * stride + c1, T(0));
+        });
+        T* in = tables[0];
+        T* out = tables[1];
+        for (const pair<int, int>& event : events) {
+            barrier.wait();
+            T duration = T(event.first);
+            forEachStrip([&](int m, int c0, int c1) {
+                const T* source = in + (long long)(m) * stride;
+                T* target = out + (long long)(m) * stride;
+                if (event.second == 0) {
+                    knapsackRangeUpdate(source, target, c0, c1, event.first, duration);
+                    return;
+                }
+                copy(source + c0, source + c1, target + c0);
+                if (m >= event.second) {
+                    knapsackShiftMax(source - (long long)(event.second) * stride, target, c0, c1,
+                                     event.first, duration);
+                }
+            });
+            swap(in, out);
         }
-        for (int j = 0; j <= money; j++) {
-            dp[0][j] = dp[1][j];
+    });
+    return tables[events.size() % 2][(long long)(money) * stride + limit];
+}
+
+/* Events that are over either limit on their own, or that last no time
+ * at all, can never change the answer and are dropped before the
+ * sweep. threads <= 0 uses every hardware thread.
+ */
+long long maxMinutesDP2D(const Vector<pair<int, int>>& events, int money, int hours, int threads) {
+    if (money < 0 || hours < 0) {
+        return 0;
+    }
+    checkEvents(events);
+    if (60LL * hours > INT_MAX - TILE_COLUMNS) {
+        error("maxMinutesDP2D: time limit is too large");
+    }
+    int limit = 60 * hours;
+    Vector<pair<int, int>> useful;
+    long long total = 0;
+    for (const pair<int, int>& event : events) {
+        if (event.first > 0 && event.first <= limit && event.second <= money) {
+            useful.add(event);
+            total += event.first;
+        }
+    }
+    if (threads <= 0) {
+        threads = ThreadPool::hardwareThreads();
+    }
+    static thread_local DPArena arena;
+    if (min(total, (long long)(limit)) <= UINT16_MAX) {
+        return maxMinutesDP2DTyped<uint16_t>(useful, money, limit, threads, arena);
+    }
+    return maxMinutesDP2DTyped<uint32_t>(useful, money, limit, threads, arena);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Eleventh Approach: Repeated Performances
+ *  Time Complexity: O(m*n) with the monotone queue, O(m*n*log(c)/w) with
+ *                   binary splitting, c is the largest count
+ *  Space Complexity: O(m)
+ **/
+
+/* A performance that runs count times can be attended up to count
+ * times, which used to mean listing it count times. Two ways of folding
+ * it into the DP row directly:
+ *
+ * Binary splitting replaces count copies with bundles of 1, 2, 4, ...
+ * copies and a remainder, which can still add up to any number of
+ * copies from 0 to count. The bundles are ordinary events, so they run
+ * through the vector row kernel, and the work per performance drops
+ * from count sweeps to about log2(count).
+ *
+ * The monotone queue takes one sweep per performance no matter the
+ * count. Budgets with the same remainder r modulo the cost form a chain
+ * r, r + cost, r + 2*cost, ..., and along a chain
+ * f(r + q*cost) = max over q - count <= p <= q of
+ *                 (old(r + p*cost) - p*duration) + q*duration,
+ * a maximum over a sliding window of width count + 1, which a deque of
+ * candidates in decreasing order keeps in O(1) amortized per step. It is
+ * scalar, so it only pays off against a scalar row kernel and only once
+ * a performance has enough bundles. Auto uses binary splitting unless
+ * the row kernel runs without SIMD and the performance splits into more
+ * than MAX_SPLIT_BUNDLES bundles, in which case it uses the queue.
+ */
+
+/* One queue pass costs about as much as ten sweeps of the scalar row
+ * kernel, but more than 31 sweeps of any vector kernel, and 31 is the
+ * most bundles an int count can split into. So Auto only hands a
+ * performance to the queue when the row kernel has no SIMD to use and
+ * the performance needs more than MAX_SPLIT_BUNDLES bundles.
+ */
+static const int MAX_SPLIT_BUNDLES = 10;
+
+template <typename T>
+static void addBundles(T* row, int money, const RepeatedEvent& event, int copies) {
+    for (int size = 1; copies > 0; size *= 2) {
+        int bundle = min(size, copies);
+        knapsackRowUpdate(row, money, bundle * event.cost, T((long long)(bundle) * event.minutes));
+        copies -= bundle;
+    }
+}
+
+template <typename T>
+static void addWithQueue(T* row, int money, const RepeatedEvent& event, int copies, vector<long long>& chain,
+                         vector<int>& window) {
+    for (int r = 0; r < event.cost && r <= money; r++) {
+        chain.clear();
+        for (int j = r; j <= money; j += event.cost) {
+            chain.push_back(row[j]);
+        }
+        window.clear();
+        size_t head = 0;
+        for (int q = 0; q < int(chain.size()); q++) {
+            long long candidate = chain[q] - (long long)(q) * event.minutes;
+            while (window.size() > head &&
+                   chain[window.back()] - (long long)(window.back()) * event.minutes <= candidate) {
+                window.pop_back();
+            }
+            window.push_back(q);
+            while (window[head] < q - copies) {
+                head++;
+            }
+            int p = window[head];
+            row[r + (long long)(q) * event.cost] = T(chain[p] + (long long)(q - p) * event.minutes);
+        }
+    }
+}
+
+template <typename T>
+static T maxMinutesRepeatedTyped(const Vector<RepeatedEvent>& events, int money, RepeatStrategy strategy,
+                                 DPArena& arena, T freeMinutes) {
+    T* row = arena.row<T>(money + 1);
+    fill(row, row + money + 1, T(0));
+    vector<long long> chain;
+    vector<int> window;
+    for (const RepeatedEvent& event : events) {
+        if (event.cost == 0 || event.cost > money || event.count == 0) {
+            continue;
+        }
+        int copies = min(event.count, money / event.cost);
+        int bundles = 32 - __builtin_clz(unsigned(copies));
+        bool queue = strategy == RepeatStrategy::MonotoneQueue ||
+                     (strategy == RepeatStrategy::Auto && activeSimdLevel() == SimdLevel::Scalar &&
+                      bundles > MAX_SPLIT_BUNDLES);
+        if (queue) {
+            addWithQueue(row, money, event, copies, chain, window);
+        }
+        else {
+            addBundles(row, money, event, copies);
         }
     }
-    return dp[1][money];
+    return T(row[money] + freeMinutes);
+}
+
+/* Free performances are always attended every time and are added at the
+ * end; copies beyond what the budget could ever buy are ignored. The row
+ * type is chosen from the total the affordable copies could reach.
+ */
+long long maxMinutesRepeated(const Vector<RepeatedEvent>& events, int money, RepeatStrategy strategy) {
+    if (money < 0) {
+        return 0;
+    }
+    long long total = 0;
+    long long freeMinutes = 0;
+    for (const RepeatedEvent& event : events) {
+        if (event.minutes < 0 || event.cost < 0 || event.count < 0) {
+            error("maxMinutesRepeated: durations, costs and counts must be non-negative");
+        }
+        if (event.cost == 0) {
+            freeMinutes += (long long)(event.minutes) * event.count;
+        }
+        else if (event.cost <= money) {
+            total += (long long)(event.minutes) * min(event.count, money / event.cost);
+        }
+    }
+    static thread_local DPArena arena;
+    if (total + freeMinutes <= UINT16_MAX) {
+        return maxMinutesRepeatedTyped<uint16_t>(events, money, strategy, arena, uint16_t(freeMinutes));
+    }
+    if (total + freeMinutes <= UINT32_MAX) {
+        return maxMinutesRepeatedTyped<uint32_t>(events, money, strategy, arena, uint32_t(freeMinutes));
+    }
+    return maxMinutesRepeatedTyped<uint64_t>(events, money, strategy, arena, uint64_t(freeMinutes));
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Twelfth Approach: Approximation Scheme
+ *  Time Complexity: O(n^2/epsilon), independent of the budget and durations
+ *  Space Complexity: O(n/epsilon)
+ **/
+
+/* When both the budget and the durations are large, no exact DP is
+ * cheap, but a selection within a factor (1 - epsilon) of the best is:
+ * durations are divided by a scale K and rounded down, and a DP over
+ * the scaled minutes finds, for every scaled total, the cheapest set of
+ * events reaching it. Rounding loses less than K per event, so less
+ * than n*K overall, and choosing K = epsilon*L/n for any lower bound L
+ * on the optimum keeps that loss under epsilon times the optimum.
+ *
+ * The bounds come from the greedy fill by minutes per dollar: its whole
+ * events (or the single longest affordable event, if that is more) are
+ * a valid selection and give L, and its fractional bound U caps the
+ * optimum. U is at most 2L, so the scaled DP never needs more than
+ * U/K = O(n/epsilon) entries. K is rounded down to a whole number, which
+ * only makes the answer more accurate; K = 1 makes it exact.
+ *
+ * The DP also tracks the true minutes of each cheapest set, and the
+ * best affordable one is returned with a proven upper bound on the
+ * optimum, the smaller of U and K times (best scaled total + n).
+ */
+
+static void greedyBounds(const vector<pair<long long, long long>>& events, long long money, long long& lower,
+                         long long& upper) {
+    vector<pair<long long, long long>> byRatio = events;
+    sort(byRatio.begin(), byRatio.end(), [](const pair<long long, long long>& a, const pair<long long, long long>& b) {
+        return a.first * b.second > b.first * a.second;
+    });
+    long long longest = 0;
+    for (const pair<long long, long long>& event : byRatio) {
+        longest = max(longest, event.first);
+    }
+    lower = 0;
+    upper = 0;
+    long long left = money;
+    for (const pair<long long, long long>& event : byRatio) {
+        if (event.second > left) {
+            upper = lower + left * event.first / event.second;
+            lower = max(lower, longest);
+            return;
+        }
+        left -= event.second;
+        lower += event.first;
+    }
+    upper = lower;
+}
+
+ApproxMinutes maxMinutesApprox(const Vector<pair<int, int>>& events, long long money, double epsilon) {
+    if (!(epsilon > 0 && epsilon < 1)) {
+        error("maxMinutesApprox: epsilon must be between 0 and 1");
+    }
+    ApproxMinutes result = {0, 0, 0, 0};
+    if (money < 0) {
+        return result;
+    }
+    checkEvents(events);
+    long long freeMinutes = 0;
+    vector<pair<long long, long long>> affordable;
+    for (const pair<int, int>& event : events) {
+        if (event.second == 0) {
+            freeMinutes += event.first;
+        }
+        else if (event.second <= money && event.first > 0) {
+            affordable.push_back({event.first, event.second});
+        }
+    }
+    long long lower = 0;
+    long long upper = 0;
+    greedyBounds(affordable, money, lower, upper);
+    int n = int(affordable.size());
+    long long scale = max(1LL, (long long)(epsilon * lower / max(1, n)));
+    long long top = upper / scale;
+
+    const long long UNREACHABLE = LLONG_MAX;
+    vector<long long> cheapest(top + 1, UNREACHABLE);
+    vector<long long> minutes(top + 1, 0);
+    cheapest[0] = 0;
+    for (const pair<long long, long long>& event : affordable) {
+        long long scaled = event.first / scale;
+        if (scaled == 0) {
+            continue;
+        }
+        result.cells += max(0LL, top - scaled + 1);
+        for (long long v = top; v >= scaled; v--) {
+            long long from = cheapest[v - scaled];
+            if (from == UNREACHABLE || from + event.second > money) {
+                continue;
+            }
+            long long cost = from + event.second;
+            long long total = minutes[v - scaled] + event.first;
+            if (cost < cheapest[v] || (cost == cheapest[v] && total > minutes[v])) {
+                cheapest[v] = cost;
+                minutes[v] = total;
+            }
+        }
+    }
+    long long bestScaled = 0;
+    long long best = 0;
+    for (long long v = 0; v <= top; v++) {
+        if (cheapest[v] != UNREACHABLE) {
+            bestScaled = v;
+            best = max(best, minutes[v]);
+        }
+    }
+    best = max(best, lower);
+    long long bound = (scale == 1) ? best : min(upper, scale * (bestScaled + n));
+    result.minutes = freeMinutes + best;
+    result.upperBound = freeMinutes + max(bound, best);
+    result.relativeError = (result.upperBound == 0) ? 0 : 1 - double(result.minutes) / result.upperBound;
+    return result;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** Batch Budget Queries
+ *  Time Complexity: O(m*n/w) once, then O(1) per budget
+ *  Space Complexity: O(m)
+ **/
+
+/* The final row of the bottom-up DP already holds the answer for every
+ * budget from 0 to money, so a single pass for the largest budget of
+ * interest answers all of the smaller ones too. The curve keeps a copy
+ * of that row so later lookups are a single array access.
+ */
+
+template <typename T>
+static void buildCurve(const Vector<pair<int, int>>& events, int maxMoney, DPArena& arena,
+                       vector<long long>& minutes) {
+    maxMinutesDPTyped<T>(events, maxMoney, arena);
+    const T* row = arena.row<T>(maxMoney + 1);
+    minutes.assign(row, row + maxMoney + 1);
+}
+
+BudgetCurve::BudgetCurve(const Vector<pair<int, int>>& events, int maxMoney, DPArena& arena) {
+    if (maxMoney < 0) {
+        error("BudgetCurve: maxMoney must be non-negative");
+    }
+    long long total = affordableMinutes(events, maxMoney);
+    if (total <= UINT16_MAX) {
+        buildCurve<uint16_t>(events, maxMoney, arena, minutes);
+    }
+    else if (total <= UINT32_MAX) {
+        buildCurve<uint32_t>(events, maxMoney, arena, minutes);
+    }
+    else {
+        buildCurve<uint64_t>(events, maxMoney, arena, minutes);
+    }
+}
+
+int BudgetCurve::maxMoney() const {
+    return int(minutes.size()) - 1;
+}
+
+/* Negative budgets buy nothing; budgets past the end of the curve are
+ * an error, since the curve cannot know what more money would buy.
+ */
+long long BudgetCurve::operator[](int money) const {
+    if (money < 0) {
+        return 0;
+    }
+    if (money > maxMoney()) {
+        error("BudgetCurve: budget is larger than the curve's maxMoney");
+    }
+    return minutes[money];
+}
+
+BudgetCurve budgetCurve(const Vector<pair<int, int>>& events, int maxMoney) {
+    static thread_local DPArena arena;
+    return BudgetCurve(events, maxMoney, arena);
+}
+
+Vector<long long> maxMinutesForBudgets(const Vector<pair<int, int>>& events, const Vector<int>& budgets) {
+    Vector<long long> answers;
+    if (budgets.isEmpty()) {
+        return answers;
+    }
+    int largest = max(0, *max_element(budgets.begin(), budgets.end()));
+    BudgetCurve curve = budgetCurve(events, largest);
+    for (int money : budgets) {
+        answers.add(curve[money]);
+    }
+    return answers;
 }
 
 /* * * * * * Test Cases Below This Point * * * * * */
@@ -207,6 +1406,426 @@ STUDENT_TEST("Test all three functions on edge cases") {
     EXPECT_EQUAL(maxMinutesDP(musicEvents, 20), 80);
 }
 
+STUDENT_TEST("DP matches the memoized version at every instruction set level") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesDP(musicEvents, 15), 81);
+    EXPECT_EQUAL(maxMinutesDP({}, 20), 0);
+    EXPECT_EQUAL(maxMinutesDP(musicEvents, 0), 0);
+
+    SimdLevel best = detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        setSimdLevel(level);
+        for (int trial = 0; trial < 20; trial++) {
+            musicEvents.clear();
+            int n = randomInteger(1, 40);
+            for (int i = 0; i < n; i++) {
+                musicEvents.add({randomInteger(50, 150), randomInteger(0, 60)});
+            }
+            int money = randomInteger(0, 300);
+            EXPECT_EQUAL(maxMinutesDP(musicEvents, money), maxMinutesMemo(musicEvents, money));
+        }
+    }
+    setSimdLevel(best);
+}
+
+STUDENT_TEST("DP picks a row type wide enough for the total duration") {
+    DPArena arena;
+    // Fits in uint16_t
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {30, 5}, {15, 3}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesDPTyped<uint16_t>(musicEvents, 15, arena), 70);
+    EXPECT_EQUAL(maxMinutesDPTyped<uint64_t>(musicEvents, 15, arena), 70);
+
+    // Needs uint32_t
+    musicEvents = {{40000, 10}, {30000, 5}, {15000, 3}, {5000, 1}};
+    EXPECT_EQUAL(maxMinutesDP(musicEvents, 15, arena), 70000);
+
+    // Needs uint64_t, and overflows the int returned by the wrapper
+    musicEvents = {{2000000000, 10}, {2000000000, 5}, {1, 1}};
+    EXPECT_EQUAL(maxMinutesDP(musicEvents, 15, arena), 4000000000LL);
+    EXPECT_EQUAL(maxMinutesDP(musicEvents, 16, arena), 4000000001LL);
+
+    // Compile-time selection from a known bound
+    static_assert(std::is_same<DPValue<65535>, uint16_t>::value, "narrow totals use 16-bit rows");
+    static_assert(std::is_same<DPValue<65536>, uint32_t>::value, "wider totals use 32-bit rows");
+    static_assert(std::is_same<DPValue<5000000000LL>, uint64_t>::value, "huge totals use 64-bit rows");
+
+    EXPECT_ERROR(maxMinutesDP({{-5, 3}}, 10, arena));
+}
+
+STUDENT_TEST("DP reuses its arena and handles budgets too large for the stack") {
+    DPArena arena;
+    Vector<pair<int, int>> musicEvents = {{75, 15}, {9, 3}, {60, 10}, {24, 8}, {10, 1}};
+    EXPECT_EQUAL(maxMinutesDP(musicEvents, 20, arena), 94);
+    int allocations = arena.allocations();
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQUAL(maxMinutesDP(musicEvents, 20, arena), 94);
+        EXPECT_EQUAL(maxMinutesDP(musicEvents, 15, arena), 79);
+    }
+    EXPECT_EQUAL(arena.allocations(), allocations);
+    EXPECT_EQUAL(reinterpret_cast<uintptr_t>(arena.row<uint32_t>(21)) % DPArena::CACHE_LINE, 0);
+
+    // 8 million cents: two int rows of this size used to live on the stack
+    musicEvents = {{100, 3000000}, {90, 2500000}, {80, 4000000}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesDP(musicEvents, 8000000), 195);
+}
+
+STUDENT_TEST("Parallel DP matches the sequential DP for any thread count") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesDPParallel(musicEvents, 15, 4), 81);
+    EXPECT_EQUAL(maxMinutesDPParallel({}, 20, 4), 0);
+    EXPECT_EQUAL(maxMinutesDPParallel(musicEvents, 0, 4), 0);
+
+    DPArena arena;
+    for (int threads = 1; threads <= 8; threads++) {
+        musicEvents.clear();
+        for (int i = 0; i < 30; i++) {
+            musicEvents.add({randomInteger(50, 150), randomInteger(0, 20000)});
+        }
+        int money = randomInteger(30000, 60000);
+        long long expected = maxMinutesDP(musicEvents, money, arena);
+        EXPECT_EQUAL(maxMinutesDPParallel(musicEvents, money, threads, arena), expected);
+        EXPECT_EQUAL(maxMinutesDPParallelTyped<uint32_t>(musicEvents, money, threads, arena), expected);
+        EXPECT_EQUAL(maxMinutesDPParallelTyped<uint64_t>(musicEvents, money, threads, arena), expected);
+    }
+}
+
+/* Checks that a selection is valid and achieves the given total. */
+static void expectSelection(const Vector<pair<int, int>>& events, int money, const Vector<int>& chosen,
+                            long long expected) {
+    long long minutes = 0;
+    long long cost = 0;
+    for (int i = 0; i < chosen.size(); i++) {
+        EXPECT(i == 0 || chosen[i - 1] < chosen[i]);
+        minutes += events[chosen[i]].first;
+        cost += events[chosen[i]].second;
+    }
+    EXPECT(cost <= money);
+    EXPECT_EQUAL(minutes, expected);
+}
+
+STUDENT_TEST("Selection returns an optimal set of events") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {30, 5}, {15, 3}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesWithSelection(musicEvents, 15), Vector<int>({0, 1}));
+
+    // Two subsets with total duration 84 minutes and total cost 18 dollars
+    musicEvents = {{75, 15}, {9, 3}, {60, 10}, {24, 8}, {10, 1}};
+    expectSelection(musicEvents, 20, maxMinutesWithSelection(musicEvents, 20), 94);
+
+    EXPECT_EQUAL(maxMinutesWithSelection({}, 20), Vector<int>());
+    EXPECT_EQUAL(maxMinutesWithSelection(musicEvents, 0), Vector<int>());
+    musicEvents = {{40, 25}, {30, 30}, {60, 22}};
+    EXPECT_EQUAL(maxMinutesWithSelection(musicEvents, 20), Vector<int>());
+
+    DPArena arena;
+    for (int trial = 0; trial < 50; trial++) {
+        musicEvents.clear();
+        int n = randomInteger(1, 60);
+        for (int i = 0; i < n; i++) {
+            musicEvents.add({randomInteger(0, 150), randomInteger(0, 60)});
+        }
+        int money = randomInteger(0, 500);
+        expectSelection(musicEvents, money, maxMinutesWithSelection(musicEvents, money, arena),
+                        maxMinutesDP(musicEvents, money, arena));
+    }
+}
+
+STUDENT_TEST("Meet in the middle matches the backtracking version") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesMeetInMiddle(musicEvents, 15), 81);
+    EXPECT_EQUAL(maxMinutesMeetInMiddle({}, 20), 0);
+    EXPECT_EQUAL(maxMinutesMeetInMiddle(musicEvents, 0), 0);
+    EXPECT_EQUAL(maxMinutesMeetInMiddle({{80, 16}}, 20), 80);
+
+    for (int trial = 0; trial < 100; trial++) {
+        musicEvents.clear();
+        int n = randomInteger(1, 14);
+        for (int i = 0; i < n; i++) {
+            musicEvents.add({randomInteger(0, 150), randomInteger(0, 60)});
+        }
+        int money = randomInteger(0, 300);
+        EXPECT_EQUAL(maxMinutesMeetInMiddle(musicEvents, money), maxMinutesNaive(musicEvents, money));
+    }
+}
+
+STUDENT_TEST("Meet in the middle handles budgets beyond the range of the DP") {
+    Vector<pair<int, int>> musicEvents;
+    for (int i = 0; i < 40; i++) {
+        musicEvents.add({100 + i, 1000000000});
+    }
+    // Budgets in the billions: exactly five events fit
+    EXPECT_EQUAL(maxMinutesMeetInMiddle(musicEvents, 5000000000LL), 139 + 138 + 137 + 136 + 135);
+    EXPECT_EQUAL(maxMinutesMeetInMiddle(musicEvents, 40000000000LL), 40 * 100 + 39 * 40 / 2);
+}
+
+STUDENT_TEST("Pareto frontier engine matches the DP") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesPareto(musicEvents, 15), 81);
+    long long entries = 0;
+    maxMinutesPareto(musicEvents, 15, entries);
+    EXPECT(entries >= musicEvents.size() && entries <= musicEvents.size() * 16);
+    EXPECT_EQUAL(maxMinutesPareto({}, 20), 0);
+    EXPECT_EQUAL(maxMinutesPareto(musicEvents, 0), 0);
+
+    DPArena arena;
+    for (int trial = 0; trial < 50; trial++) {
+        musicEvents.clear();
+        int n = randomInteger(1, 100);
+        for (int i = 0; i < n; i++) {
+            musicEvents.add({randomInteger(0, 150), randomInteger(0, 2000)});
+        }
+        int money = randomInteger(0, 20000);
+        long long expected = maxMinutesDP(musicEvents, money, arena);
+        EXPECT_EQUAL(maxMinutesPareto(musicEvents, money), expected);
+        EXPECT_EQUAL(maxMinutesAuto(musicEvents, money), expected);
+    }
+}
+
+STUDENT_TEST("Planner picks the frontier for sparse prices and the DP for dense ones") {
+    KnapsackEngine engine;
+    // A few hundred events priced in cents up to a million
+    Vector<pair<int, int>> musicEvents;
+    for (int i = 0; i < 300; i++) {
+        musicEvents.add({randomInteger(50, 150), randomInteger(100000, 1000000)});
+    }
+    long long answer = maxMinutesAuto(musicEvents, 2000000, engine);
+    EXPECT(engine == KnapsackEngine::Pareto);
+    EXPECT_EQUAL(answer, maxMinutesDP(musicEvents, 2000000));
+
+    // Thousands of cheap events: every budget is reachable, so the frontier is a full row
+    musicEvents.clear();
+    for (int i = 0; i < 2000; i++) {
+        musicEvents.add({randomInteger(1, 100000), randomInteger(1, 30)});
+    }
+    answer = maxMinutesAuto(musicEvents, 5000, engine);
+    EXPECT(engine == KnapsackEngine::Dense);
+    EXPECT_EQUAL(answer, maxMinutesDP(musicEvents, 5000));
+
+    // Budgets past the range of a DP row stay on the frontier
+    EXPECT_EQUAL(maxMinutesAuto({{100, 2000000000}, {50, 2000000000}}, 4000000000LL, engine), 150);
+    EXPECT(engine == KnapsackEngine::Pareto);
+}
+
+STUDENT_TEST("Budget sweep answers every budget from one DP pass") {
+    Vector<pair<int, int>> musicEvents = {{75, 15}, {9, 3}, {60, 10}, {24, 8}, {10, 1}};
+    Vector<int> budgets = {20, 0, 15, 7, -3, 1};
+    Vector<long long> expected = {94, 0, 79, 19, 0, 10};
+    EXPECT_EQUAL(maxMinutesForBudgets(musicEvents, budgets), expected);
+    EXPECT_EQUAL(maxMinutesForBudgets(musicEvents, {}), Vector<long long>());
+
+    BudgetCurve curve = budgetCurve(musicEvents, 30);
+    EXPECT_EQUAL(curve.maxMoney(), 30);
+    for (int money = 0; money <= 30; money++) {
+        EXPECT_EQUAL(curve[money], maxMinutesDP(musicEvents, money));
+    }
+    EXPECT_ERROR(curve[31]);
+
+    // Durations too large for int still come back exactly
+    curve = budgetCurve({{2000000000, 10}, {2000000000, 5}}, 15);
+    EXPECT_EQUAL(curve[15], 4000000000LL);
+}
+
+STUDENT_TEST("Branch and bound matches the DP for any thread count") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesBranchAndBound(musicEvents, 15), 81);
+    long long nodes = 0;
+    for (int threads : {1, 4}) {
+        EXPECT_EQUAL(maxMinutesBranchAndBound(musicEvents, 15, threads, nodes), 81);
+        EXPECT(nodes >= 1 && nodes < (1 << 7));
+    }
+    EXPECT_EQUAL(maxMinutesBranchAndBound({}, 20), 0);
+    EXPECT_EQUAL(maxMinutesBranchAndBound(musicEvents, 0), 0);
+    EXPECT_EQUAL(maxMinutesBranchAndBound(musicEvents, -5), 0);
+    EXPECT_EQUAL(maxMinutesBranchAndBound({{80, 16}, {7, 0}}, 20), 87);
+    EXPECT_ERROR(maxMinutesBranchAndBound({{-1, 3}}, 20));
+
+    for (int trial = 0; trial < 100; trial++) {
+        musicEvents.clear();
+        int n = randomInteger(1, 40);
+        for (int i = 0; i < n; i++) {
+            musicEvents.add({randomInteger(0, 150), randomInteger(0, 60)});
+        }
+        int money = randomInteger(0, 600);
+        int threads = randomInteger(1, 8);
+        EXPECT_EQUAL(maxMinutesBranchAndBound(musicEvents, money, threads), maxMinutesDP(musicEvents, money));
+    }
+
+    // Budgets in the billions, where only an exact search can answer
+    musicEvents.clear();
+    for (int i = 0; i < 30; i++) {
+        musicEvents.add({randomInteger(0, 1000000), randomInteger(0, 1000000000)});
+    }
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        EXPECT_EQUAL(maxMinutesBranchAndBound(musicEvents, 6000000000LL, threads),
+                     maxMinutesMeetInMiddle(musicEvents, 6000000000LL));
+    }
+}
+
+STUDENT_TEST("Top-down engine matches the memoized version and counts its states") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    EXPECT_EQUAL(maxMinutesTopDown(musicEvents, 15), 81);
+    EXPECT_EQUAL(maxMinutesTopDown({}, 20), 0);
+    EXPECT_EQUAL(maxMinutesTopDown(musicEvents, -1), 0);
+    EXPECT_ERROR(maxMinutesTopDown({{10, -2}}, 20));
+
+    // Everything fits, so the suffix sums answer without visiting a state
+    TopDownStats stats;
+    EXPECT_EQUAL(maxMinutesTopDown(musicEvents, 28, stats), 136);
+    EXPECT_EQUAL(stats.states, 0);
+    EXPECT_EQUAL(maxMinutesTopDown(musicEvents, 15, stats), 81);
+    EXPECT(stats.states > 0 && stats.states <= 6 * 16);
+    EXPECT(stats.memoBytes > 0);
+
+    for (int trial = 0; trial < 100; trial++) {
+        musicEvents.clear();
+        int n = randomInteger(1, 30);
+        for (int i = 0; i < n; i++) {
+            musicEvents.add({randomInteger(0, 150), randomInteger(0, 60)});
+        }
+        int money = randomInteger(0, 500);
+        EXPECT_EQUAL(maxMinutesTopDown(musicEvents, money), maxMinutesMemo(musicEvents, money));
+    }
+
+    // Deep enough to overflow a recursive search's stack
+    musicEvents.clear();
+    for (int i = 0; i < 300000; i++) {
+        musicEvents.add({50, 10});
+    }
+    musicEvents.add({7, 3});
+    musicEvents.add({9, 4});
+    EXPECT_EQUAL(maxMinutesTopDown(musicEvents, 5, stats), 9);
+    EXPECT_EQUAL(stats.states, 300002);
+
+    // A budget no dense table could hold; with irregular prices the
+    // states grow like 2^n, so the events are kept few
+    musicEvents.clear();
+    for (int i = 0; i < 18; i++) {
+        musicEvents.add({randomInteger(0, 1000000), randomInteger(0, 1000000000)});
+    }
+    EXPECT_EQUAL(maxMinutesTopDown(musicEvents, 6000000000LL), maxMinutesMeetInMiddle(musicEvents, 6000000000LL));
+}
+
+/* The backtracking search extended with a time limit, as the reference
+ * for the two-constraint solver.
+ */
+static int maxMinutesNaive2D(const Vector<pair<int, int>>& events, int money, int timeLeft, int index) {
+    if (money < 0 || timeLeft < 0) {
+        return -1;
+    }
+    if (index == events.size()) {
+        return 0;
+    }
+    int take = maxMinutesNaive2D(events, money - events[index].second, timeLeft - events[index].first, index + 1);
+    int skip = maxMinutesNaive2D(events, money, timeLeft, index + 1);
+    return max(take < 0 ? -1 : take + events[index].first, skip);
+}
+
+STUDENT_TEST("Two-constraint DP matches the extended backtracking version") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    // One hour: the 40, 15 and 5 minute events for 14 of the 15 dollars
+    EXPECT_EQUAL(maxMinutesDP2D(musicEvents, 15, 1), 60);
+    EXPECT_EQUAL(maxMinutesDP2D(musicEvents, 15, 2), 81);
+    EXPECT_EQUAL(maxMinutesDP2D(musicEvents, 15, 0), 0);
+    EXPECT_EQUAL(maxMinutesDP2D({}, 15, 3), 0);
+    EXPECT_EQUAL(maxMinutesDP2D({{30, 0}, {25, 0}, {20, 0}}, 0, 1), 55);
+    EXPECT_ERROR(maxMinutesDP2D({{-30, 0}}, 10, 1));
+
+    for (int trial = 0; trial < 100; trial++) {
+        musicEvents.clear();
+        int n = randomInteger(1, 12);
+        for (int i = 0; i < n; i++) {
+            musicEvents.add({randomInteger(0, 150), randomInteger(0, 60)});
+        }
+        int money = randomInteger(0, 300);
+        int hours = randomInteger(0, 12);
+        int expected = maxMinutesNaive2D(musicEvents, money, 60 * hours, 0);
+        EXPECT_EQUAL(maxMinutesDP2D(musicEvents, money, hours, 1), expected);
+        EXPECT_EQUAL(maxMinutesDP2D(musicEvents, money, hours, randomInteger(2, 8)), expected);
+    }
+
+    // A time limit that does not bind gives the 1D answer, in parallel too
+    musicEvents.clear();
+    for (int i = 0; i < 60; i++) {
+        musicEvents.add({randomInteger(0, 150), randomInteger(0, 300)});
+    }
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        EXPECT_EQUAL(maxMinutesDP2D(musicEvents, 2000, 200, threads), maxMinutesDP(musicEvents, 2000));
+    }
+}
+
+/* Lists every showing separately, the way repeated performances had to
+ * be entered before counts.
+ */
+static Vector<pair<int, int>> expandRepeats(const Vector<RepeatedEvent>& events) {
+    Vector<pair<int, int>> expanded;
+    for (const RepeatedEvent& event : events) {
+        for (int i = 0; i < event.count; i++) {
+            expanded.add({event.minutes, event.cost});
+        }
+    }
+    return expanded;
+}
+
+STUDENT_TEST("Repeated performances match listing every showing") {
+    Vector<RepeatedEvent> performances = {{40, 10, 2}, {28, 7, 1}, {18, 2, 3}, {5, 1, 4}};
+    // Three 18 minute showings and four 5 minute ones for 10 dollars
+    EXPECT_EQUAL(maxMinutesRepeated(performances, 10), 74);
+    EXPECT_EQUAL(maxMinutesRepeated({}, 10), 0);
+    EXPECT_EQUAL(maxMinutesRepeated(performances, -1), 0);
+    EXPECT_EQUAL(maxMinutesRepeated({{30, 0, 3}, {20, 5, 0}}, 10), 90);
+    EXPECT_ERROR(maxMinutesRepeated({{30, 2, -1}}, 10));
+
+    Vector<RepeatStrategy> strategies = {RepeatStrategy::Auto, RepeatStrategy::BinarySplit,
+                                         RepeatStrategy::MonotoneQueue};
+    for (int trial = 0; trial < 100; trial++) {
+        performances.clear();
+        int n = randomInteger(1, 10);
+        for (int i = 0; i < n; i++) {
+            performances.add({randomInteger(0, 150), randomInteger(0, 40), randomInteger(0, 12)});
+        }
+        int money = randomInteger(0, 400);
+        long long expected = maxMinutesDP(expandRepeats(performances), money);
+        for (RepeatStrategy strategy : strategies) {
+            EXPECT_EQUAL(maxMinutesRepeated(performances, money, strategy), expected);
+        }
+    }
+
+    // Counts far beyond what the budget could ever buy
+    performances = {{100, 3, 1000000000}, {250, 7, 2000000000}};
+    EXPECT_EQUAL(maxMinutesRepeated(performances, 20), maxMinutesDP(expandRepeats({{100, 3, 6}, {250, 7, 2}}), 20));
+}
+
+STUDENT_TEST("Approximation stays within epsilon of the DP and reports its bound") {
+    Vector<pair<int, int>> musicEvents = {{40, 10}, {28, 7}, {30, 5}, {18, 2}, {15, 3}, {5, 1}};
+    ApproxMinutes approx = maxMinutesApprox(musicEvents, 15, 0.1);
+    EXPECT_EQUAL(approx.minutes, 81);
+    EXPECT_EQUAL(approx.upperBound, 81);
+    EXPECT_EQUAL(approx.relativeError, 0);
+    EXPECT(approx.cells > 0);
+    EXPECT_EQUAL(maxMinutesApprox({}, 15, 0.5).minutes, 0);
+    EXPECT_EQUAL(maxMinutesApprox({{20, 0}, {30, 40}}, 15, 0.5).minutes, 20);
+    EXPECT_EQUAL(maxMinutesApprox(musicEvents, -1, 0.5).minutes, 0);
+    EXPECT_ERROR(maxMinutesApprox(musicEvents, 15, 0));
+    EXPECT_ERROR(maxMinutesApprox(musicEvents, 15, 1.5));
+
+    Vector<double> epsilons = {0.5, 0.25, 0.1, 0.01};
+    for (int trial = 0; trial < 50; trial++) {
+        musicEvents.clear();
+        int n = randomInteger(1, 60);
+        for (int i = 0; i < n; i++) {
+            musicEvents.add({randomInteger(0, 100000), randomInteger(0, 5000)});
+        }
+        int money = randomInteger(0, 40000);
+        long long exact = maxMinutesDP(musicEvents, money);
+        for (double epsilon : epsilons) {
+            approx = maxMinutesApprox(musicEvents, money, epsilon);
+            EXPECT(approx.minutes <= exact);
+            EXPECT(approx.minutes >= (1 - epsilon) * exact);
+            EXPECT(approx.upperBound >= exact);
+            EXPECT(approx.relativeError <= epsilon);
+        }
+    }
+}
+
 STUDENT_TEST("Time trials on backtracking version of maxMinutes") {
     Vector<pair<int, int>> musicEvents;
     int startSize = 10;
@@ -217,6 +1836,8 @@ STUDENT_TEST("Time trials on backtracking version of maxMinutes") {
             musicEvents.add({time, cost});
         }
         TIME_OPERATION(n, maxMinutesNaive(musicEvents, 100));
+        TIME_OPERATION(n, maxMinutesBranchAndBound(musicEvents, 100, 1));
+        TIME_OPERATION(n, maxMinutesBranchAndBound(musicEvents, 100));
         musicEvents.clear();
     }
     for (int i = 0; i < 20; i++) {
@@ -226,6 +1847,27 @@ STUDENT_TEST("Time trials on backtracking version of maxMinutes") {
     }
     for (int m = 8; m <= 500; m *= 2) {
         TIME_OPERATION(m, maxMinutesNaive(musicEvents, m));
+        TIME_OPERATION(m, maxMinutesBranchAndBound(musicEvents, m, 1));
+    }
+}
+
+STUDENT_TEST("Time trials on branch and bound from 1 to 32 threads") {
+    // Durations a fixed amount above proportional to the cost are the classic hard case
+    Vector<pair<int, int>> musicEvents;
+    for (int n = 20; n <= 60; n += 10) {
+        for (int i = 0; i < n; i++) {
+            int cost = randomInteger(1000, 100000000);
+            musicEvents.add({cost / 1000 + 100, cost});
+        }
+        TIME_OPERATION(n, maxMinutesBranchAndBound(musicEvents, 25LL * n * 1000000, 1));
+        musicEvents.clear();
+    }
+    for (int i = 0; i < 60; i++) {
+        int cost = randomInteger(1000, 100000000);
+        musicEvents.add({cost / 1000 + 100, cost});
+    }
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        TIME_OPERATION(threads, maxMinutesBranchAndBound(musicEvents, 1500000000LL, threads));
     }
 }
 
@@ -251,6 +1893,42 @@ STUDENT_TEST("Time trials on memoized version of maxMinutes") {
     }
 }
 
+/* Runs the top-down engine and reports the states it reached and its
+ * memo's size next to what the memoized version's grid takes.
+ */
+static long long topDownWithReport(const Vector<pair<int, int>>& events, int money) {
+    TopDownStats stats;
+    long long answer = maxMinutesTopDown(events, money, stats);
+    cout << "    n = " << events.size() << ", money = " << money << ": " << stats.states << " of "
+         << (long long)(events.size()) * (money + 1) << " states, " << stats.memoBytes << " memo bytes vs "
+         << (long long)(events.size()) * (money + 1) * sizeof(int) << " grid bytes" << endl;
+    return answer;
+}
+
+STUDENT_TEST("Time trials comparing the top-down engine against the memoized version") {
+    Vector<pair<int, int>> musicEvents;
+    for (int n = 10; n <= 2500; n *= 2) {
+        for (int i = 0; i < n; i++) {
+            int time = randomInteger(50, 150);
+            int cost = randomInteger(0, 30);
+            musicEvents.add({time, cost});
+        }
+        TIME_OPERATION(n, maxMinutesMemo(musicEvents, 100));
+        TIME_OPERATION(n, topDownWithReport(musicEvents, 100));
+        musicEvents.clear();
+    }
+    // Few, expensive events reach only a sliver of a large table
+    for (int i = 0; i < 20; i++) {
+        int time = randomInteger(50, 150);
+        int cost = randomInteger(1000, 30000);
+        musicEvents.add({time, cost});
+    }
+    for (int m = 10000; m <= 160000; m *= 2) {
+        TIME_OPERATION(m, maxMinutesMemo(musicEvents, m));
+        TIME_OPERATION(m, topDownWithReport(musicEvents, m));
+    }
+}
+
 STUDENT_TEST("Time trials on DP version of maxMinutes") {
     Vector<pair<int, int>> musicEvents;
     int startSize = 50;
@@ -272,3 +1950,178 @@ STUDENT_TEST("Time trials on DP version of maxMinutes") {
         TIME_OPERATION(m, maxMinutesDP(musicEvents, m));
     }
 }
+
+STUDENT_TEST("Time trials on DP kernel instruction sets and row types") {
+    Vector<pair<int, int>> musicEvents;
+    for (int i = 0; i < 500; i++) {
+        int time = randomInteger(50, 150);
+        int cost = randomInteger(0, 3000);
+        musicEvents.add({time, cost});
+    }
+    DPArena arena;
+    SimdLevel best = detectSimdLevel();
+    for (int m = 10000; m <= 160000; m *= 2) {
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (level <= best) {
+                setSimdLevel(level);
+                cout << "    " << simdLevelName(level) << " kernel, 16/32/64-bit rows:" << endl;
+                TIME_OPERATION(m, maxMinutesDPTyped<uint16_t>(musicEvents, m, arena));
+                TIME_OPERATION(m, maxMinutesDPTyped<uint32_t>(musicEvents, m, arena));
+                TIME_OPERATION(m, maxMinutesDPTyped<uint64_t>(musicEvents, m, arena));
+            }
+        }
+    }
+    setSimdLevel(best);
+}
+
+STUDENT_TEST("Time trials on parallel DP from 1 to 32 threads") {
+    Vector<pair<int, int>> musicEvents;
+    for (int i = 0; i < 200; i++) {
+        int time = randomInteger(50, 150);
+        int cost = randomInteger(0, 1000000);
+        musicEvents.add({time, cost});
+    }
+    DPArena arena;
+    int money = 4000000;
+    TIME_OPERATION(1, maxMinutesDP(musicEvents, money, arena));
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        TIME_OPERATION(threads, maxMinutesDPParallel(musicEvents, money, threads, arena));
+    }
+}
+
+STUDENT_TEST("Time trials on the two-constraint DP from 1 to 32 threads") {
+    Vector<pair<int, int>> musicEvents;
+    for (int i = 0; i < 100; i++) {
+        int time = randomInteger(50, 150);
+        int cost = randomInteger(0, 300);
+        musicEvents.add({time, cost});
+    }
+    for (int hours = 4; hours <= 64; hours *= 2) {
+        TIME_OPERATION(hours, maxMinutesDP2D(musicEvents, 2000, hours, 1));
+    }
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        TIME_OPERATION(threads, maxMinutesDP2D(musicEvents, 2000, 32, threads));
+    }
+}
+
+STUDENT_TEST("Time trials comparing repeat counts against listing every showing") {
+    Vector<RepeatedEvent> performances;
+    int money = 20000;
+    for (int count = 1; count <= 1024; count *= 4) {
+        performances.clear();
+        for (int i = 0; i < 50; i++) {
+            performances.add({randomInteger(50, 150), randomInteger(1, 100), count});
+        }
+        Vector<pair<int, int>> expanded = expandRepeats(performances);
+        TIME_OPERATION(count, maxMinutesDP(expanded, money));
+        TIME_OPERATION(count, maxMinutesRepeated(performances, money, RepeatStrategy::BinarySplit));
+        TIME_OPERATION(count, maxMinutesRepeated(performances, money, RepeatStrategy::MonotoneQueue));
+        TIME_OPERATION(count, maxMinutesRepeated(performances, money));
+    }
+}
+
+/* Runs the approximation and reports the error it proved next to the
+ * one it was asked for.
+ */
+static long long approxWithReport(const Vector<pair<int, int>>& events, long long money, double epsilon) {
+    ApproxMinutes approx = maxMinutesApprox(events, money, epsilon);
+    cout << "    epsilon = " << epsilon << ": proved within " << approx.relativeError << endl;
+    return approx.minutes;
+}
+
+STUDENT_TEST("Time trials on the approximation scheme against the DP") {
+    Vector<pair<int, int>> musicEvents;
+    for (int i = 0; i < 500; i++) {
+        int time = randomInteger(0, 1000000000);
+        int cost = randomInteger(0, 100000);
+        musicEvents.add({time, cost});
+    }
+    int money = 5000000;
+    TIME_OPERATION(money, maxMinutesDP(musicEvents, money));
+    for (double epsilon = 0.4; epsilon >= 0.001; epsilon /= 4) {
+        TIME_OPERATION(int(1 / epsilon), approxWithReport(musicEvents, money, epsilon));
+    }
+    // Beyond the DP entirely: a budget in the trillions
+    for (double epsilon = 0.4; epsilon >= 0.001; epsilon /= 4) {
+        TIME_OPERATION(int(1 / epsilon), approxWithReport(musicEvents, 4000000000000LL, epsilon));
+    }
+}
+
+STUDENT_TEST("Time trials comparing selection against the total-only DP") {
+    Vector<pair<int, int>> musicEvents;
+    for (int i = 0; i < 2000; i++) {
+        int time = randomInteger(50, 150);
+        int cost = randomInteger(0, 3000);
+        musicEvents.add({time, cost});
+    }
+    DPArena arena;
+    for (int m = 10000; m <= 160000; m *= 2) {
+        TIME_OPERATION(m, maxMinutesDP(musicEvents, m, arena));
+        TIME_OPERATION(m, maxMinutesWithSelection(musicEvents, m, arena));
+    }
+}
+
+STUDENT_TEST("Time trials on meet in the middle for up to 50 events") {
+    Vector<pair<int, int>> musicEvents;
+    for (int n = 20; n <= 50; n += 5) {
+        for (int i = 0; i < n; i++) {
+            int time = randomInteger(50, 150);
+            int cost = randomInteger(0, 1000000000);
+            musicEvents.add({time, cost});
+        }
+        TIME_OPERATION(n, maxMinutesMeetInMiddle(musicEvents, 10000000000LL));
+        musicEvents.clear();
+    }
+    // Durations as spread out as the costs leave almost nothing to prune
+    for (int n = 20; n <= 44; n += 4) {
+        for (int i = 0; i < n; i++) {
+            int time = randomInteger(0, 1000000000);
+            int cost = randomInteger(0, 1000000000);
+            musicEvents.add({time, cost});
+        }
+        TIME_OPERATION(n, maxMinutesMeetInMiddle(musicEvents, 10000000000LL));
+        musicEvents.clear();
+    }
+}
+
+STUDENT_TEST("Time trials comparing the Pareto frontier against the DP on sparse prices") {
+    Vector<pair<int, int>> musicEvents;
+    DPArena arena;
+    for (int n = 100; n <= 1600; n *= 2) {
+        for (int i = 0; i < n; i++) {
+            int time = randomInteger(50, 150);
+            int cost = randomInteger(100000, 1000000);
+            musicEvents.add({time, cost});
+        }
+        TIME_OPERATION(n, maxMinutesDP(musicEvents, 2000000, arena));
+        TIME_OPERATION(n, maxMinutesPareto(musicEvents, 2000000));
+        TIME_OPERATION(n, maxMinutesAuto(musicEvents, 2000000));
+        musicEvents.clear();
+    }
+}
+
+/* Baseline for the budget sweep: one full DP pass per budget. */
+static Vector<long long> maxMinutesOneByOne(const Vector<pair<int, int>>& events, const Vector<int>& budgets) {
+    Vector<long long> answers;
+    for (int money : budgets) {
+        answers.add(maxMinutesDP(events, money));
+    }
+    return answers;
+}
+
+STUDENT_TEST("Time trials comparing a budget sweep against separate DP calls") {
+    Vector<pair<int, int>> musicEvents;
+    for (int i = 0; i < 500; i++) {
+        int time = randomInteger(50, 150);
+        int cost = randomInteger(0, 3000);
+        musicEvents.add({time, cost});
+    }
+    for (int queries = 10; queries <= 160; queries *= 2) {
+        Vector<int> budgets;
+        for (int i = 0; i < queries; i++) {
+            budgets.add(randomInteger(0, 100000));
+        }
+        TIME_OPERATION(queries, maxMinutesOneByOne(musicEvents, budgets));
+        TIME_OPERATION(queries, maxMinutesForBudgets(musicEvents, budgets));
+    }
+}
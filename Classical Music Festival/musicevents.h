@@ -8,9 +8,13 @@
 #include <algorithm>
 #include <cstring>
 #include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
 #include "vector.h"
 #include "grid.h"
 #include "console.h"
+#include "dparena.h"
 
 int maxMinutesNaive(Vector<std::pair<int, int>> events, int money, int minutes, int index);
 int maxMinutesNaive(Vector<std::pair<int, int>> events, int money);
@@ -18,8 +22,111 @@ int maxMinutesNaive(Vector<std::pair<int, int>> events, int money);
 int maxMinutesMemo(Vector<std::pair<int, int>> events, int money, int index, Grid<int>& memo);
 int maxMinutesMemo(Vector<std::pair<int, int>> events, int money);
 
+/* Narrowest DP row type that can hold a total of MaxTotal minutes,
+ * for callers that know a bound on the durations at compile time.
+ */
+template <long long MaxTotal>
+using DPValue = typename std::conditional<MaxTotal <= UINT16_MAX, uint16_t,
+                typename std::conditional<MaxTotal <= UINT32_MAX, uint32_t, uint64_t>::type>::type;
+
+template <typename T>
+T maxMinutesDPTyped(const Vector<std::pair<int, int>>& events, int money, DPArena& arena);
+long long maxMinutesDP(const Vector<std::pair<int, int>>& events, int money, DPArena& arena);
 int maxMinutesDP(Vector<std::pair<int, int>> events, int money);
 
+template <typename T>
+T maxMinutesDPParallelTyped(const Vector<std::pair<int, int>>& events, int money, int threads, DPArena& arena);
+long long maxMinutesDPParallel(const Vector<std::pair<int, int>>& events, int money, int threads, DPArena& arena);
+int maxMinutesDPParallel(Vector<std::pair<int, int>> events, int money, int threads = 0);
+
+Vector<int> maxMinutesWithSelection(const Vector<std::pair<int, int>>& events, int money, DPArena& arena);
+Vector<int> maxMinutesWithSelection(const Vector<std::pair<int, int>>& events, int money);
+
+long long maxMinutesMeetInMiddle(const Vector<std::pair<int, int>>& events, long long money);
+
+/* Engines the maxMinutesAuto planner can choose between. */
+enum class KnapsackEngine {
+    Dense,
+    Pareto
+};
+
+/* entries counts every frontier entry built, summed over the events. */
+long long maxMinutesPareto(const Vector<std::pair<int, int>>& events, long long money, long long& entries);
+long long maxMinutesPareto(const Vector<std::pair<int, int>>& events, long long money);
+long long maxMinutesAuto(const Vector<std::pair<int, int>>& events, long long money, KnapsackEngine& engine);
+long long maxMinutesAuto(const Vector<std::pair<int, int>>& events, long long money);
+
+/* nodes counts the search nodes whose bound was computed. */
+long long maxMinutesBranchAndBound(const Vector<std::pair<int, int>>& events, long long money, int threads,
+                                   long long& nodes);
+long long maxMinutesBranchAndBound(const Vector<std::pair<int, int>>& events, long long money, int threads = 0);
+
+/* Work done by the top-down engine: the (index, money) states it
+ * evaluated and the bytes its hash memo held when it finished.
+ */
+struct TopDownStats {
+    long long states = 0;
+    long long memoBytes = 0;
+};
+
+long long maxMinutesTopDown(const Vector<std::pair<int, int>>& events, long long money, TopDownStats& stats);
+long long maxMinutesTopDown(const Vector<std::pair<int, int>>& events, long long money);
+
+long long maxMinutesDP2D(const Vector<std::pair<int, int>>& events, int money, int hours, int threads = 0);
+
+/* A performance that runs count times, any number of which (up to
+ * count) can be attended.
+ */
+struct RepeatedEvent {
+    int minutes;
+    int cost;
+    int count;
+};
+
+/* How maxMinutesRepeated folds each performance into the DP row. Auto
+ * uses binary splitting, except that when the row kernel has no SIMD
+ * level to use it hands performances that split into more than
+ * MAX_SPLIT_BUNDLES bundles to the monotone queue.
+ */
+enum class RepeatStrategy {
+    Auto,
+    BinarySplit,
+    MonotoneQueue
+};
+
+long long maxMinutesRepeated(const Vector<RepeatedEvent>& events, int money,
+                             RepeatStrategy strategy = RepeatStrategy::Auto);
+
+/* An approximate answer: minutes is the total of a selection that fits
+ * the budget, and no selection can beat upperBound, so minutes is within
+ * relativeError = 1 - minutes / upperBound of the optimum. cells counts
+ * the entries of the scaled DP that were updated.
+ */
+struct ApproxMinutes {
+    long long minutes;
+    long long upperBound;
+    double relativeError;
+    long long cells;
+};
+
+ApproxMinutes maxMinutesApprox(const Vector<std::pair<int, int>>& events, long long money, double epsilon);
+
+/* The best total for every budget from 0 to maxMoney, computed with one
+ * DP pass and answered in O(1) per lookup.
+ */
+class BudgetCurve {
+public:
+    BudgetCurve(const Vector<std::pair<int, int>>& events, int maxMoney, DPArena& arena);
+    int maxMoney() const;
+    long long operator[](int money) const;
+
+private:
+    std::vector<long long> minutes;
+};
+
+BudgetCurve budgetCurve(const Vector<std::pair<int, int>>& events, int maxMoney);
+Vector<long long> maxMinutesForBudgets(const Vector<std::pair<int, int>>& events, const Vector<int>& budgets);
+
 
 #endif // MUSICEVENTS_H
 
@@ -0,0 +1,644 @@
+#include "shardedknapsack.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include "dparena.h"
+#include "dpkernel.h"
+#include "musicevents.h"
+#include "threadpool.h"
+#include "error.h"
+#include "testing/SimpleTest.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SHARDS_FORK 1
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/** Sharded Knapsack with (max,+) Merging
+ *  Time Complexity: O(m*n/k) per shard, plus the merges below
+ *  Space Complexity: O(m*k), k is the number of shards
+ **/
+
+/* The events are dealt round-robin into k shards, and each shard's
+ * curve (the final maxMinutesDP row over just its events) is computed
+ * independently. Two curves a and b combine by (max,+) convolution:
+ *     c[m] = max over 0 <= j <= m of a[j] + b[m - j]
+ * since any selection splits into the part from a's shard and the part
+ * from b's. The final answer only needs c[money], which takes O(m), so
+ * two shards need no full convolution at all; more shards need k - 2
+ * full merges, done pairwise in a tree so the merges of each level run
+ * side by side on the thread pool.
+ *
+ * Sharding cannot beat one maxMinutesDP on a single core: the shard
+ * curves alone are one DP's worth of work, and each level of the tree
+ * below the last adds about half a DP more when its merges are folds.
+ * With a core per shard the curves take 1/k of a DP, and the levels of
+ * folds add up to about half a DP along the critical path, so folds
+ * alone cap the speedup near 2; more cores than that only help through
+ * the blocked merges, whose output blocks split across all of them.
+ */
+
+ShardCurve shardCurve(const Vector<pair<int, int>>& events, int money) {
+    if (money < 0) {
+        error("shardCurve: money must be non-negative");
+    }
+    long long total = 0;
+    for (const pair<int, int>& event : events) {
+        total += event.first;
+    }
+    if (total > UINT32_MAX) {
+        error("shardCurve: total duration of a shard must fit in 32 bits");
+    }
+    DPArena arena;
+    maxMinutesDPTyped<uint32_t>(events, money, arena);
+    const uint32_t* row = arena.row<uint32_t>(money + 1);
+    return ShardCurve(row, row + money + 1);
+}
+
+bool isConcave(const ShardCurve& curve) {
+    for (size_t j = 2; j < curve.size(); j++) {
+        if (int64_t(curve[j]) - curve[j - 1] > int64_t(curve[j - 1]) - curve[j - 2]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Concave merge: when b is concave, the matrix
+ *     M[i][j] = a[j] + b[i - j]
+ * is totally monotone, meaning the column of each row's maximum never
+ * moves left as the row index grows, since
+ * M[i][j2] - M[i][j1] = a[j2] - a[j1] + b[i - j2] - b[i - j1] is
+ * nondecreasing in i when b's increments are nonincreasing. SMAWK then
+ * finds every row maximum in O(m) lookups. Entries with j > i do not
+ * exist; b is extended to the left with a slope steeper than any value
+ * in either curve, which keeps it concave and makes those entries lose
+ * to column j = i.
+ */
+
+struct ConcaveMerge {
+    const ShardCurve& a;
+    const ShardCurve& b;
+    long long steep;
+    vector<int> best;
+
+    ConcaveMerge(const ShardCurve& a, const ShardCurve& b) : a(a), b(b), best(a.size()) {
+        steep = 1;
+        for (size_t j = 0; j < a.size(); j++) {
+            steep = max(steep, (long long)(max(a[j], b[j])) + 1);
+        }
+    }
+
+    long long value(int i, int j) const {
+        if (j <= i) {
+            return (long long)(a[j]) + b[i - j];
+        }
+        return (long long)(a[j]) + b[0] - steep * (j - i);
+    }
+
+    /* Classic SMAWK: REDUCE prunes the columns to at most one per row,
+     * the odd rows are solved recursively, and each even row is then
+     * scanned only between its neighbours' answers.
+     */
+    void smawk(const vector<int>& rows, const vector<int>& cols) {
+        if (rows.empty()) {
+            return;
+        }
+        vector<int> kept;
+        for (int col : cols) {
+            while (!kept.empty() && value(rows[kept.size() - 1], kept.back()) < value(rows[kept.size() - 1], col)) {
+                kept.pop_back();
+            }
+            if (kept.size() < rows.size()) {
+                kept.push_back(col);
+            }
+        }
+        vector<int> odd;
+        for (size_t r = 1; r < rows.size(); r += 2) {
+            odd.push_back(rows[r]);
+        }
+        smawk(odd, kept);
+        size_t c = 0;
+        for (size_t r = 0; r < rows.size(); r += 2) {
+            int row = rows[r];
+            int last = (r + 1 < rows.size()) ? best[rows[r + 1]] : kept.back();
+            int arg = kept[c];
+            while (kept[c] != last) {
+                c++;
+                if (value(row, kept[c]) > value(row, arg)) {
+                    arg = kept[c];
+                }
+            }
+            best[row] = arg;
+        }
+    }
+};
+
+static ShardCurve concaveConvolve(const ShardCurve& a, const ShardCurve& b) {
+    ConcaveMerge merge(a, b);
+    vector<int> all(a.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        all[i] = int(i);
+    }
+    merge.smawk(all, all);
+    ShardCurve result(a.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        result[i] = uint32_t(merge.value(int(i), merge.best[i]));
+    }
+    return result;
+}
+
+/* General merge: a curve is a nondecreasing step function, so only the
+ * budgets where it steps up (its breakpoints) can be the best split;
+ * any other j loses to the last breakpoint before it, which buys the
+ * same minutes from one curve and leaves more money for the other. So
+ * the result is the lane-wise max, over the breakpoints (j, v) of the
+ * curve with fewer of them, of the other curve shifted right by j plus
+ * v, which is exactly the SIMD shift-max kernel. The output is handled
+ * in blocks of MERGE_BLOCK entries so each block stays in cache while
+ * every breakpoint is applied to it.
+ */
+
+static const int MERGE_BLOCK = 4096;
+
+static Vector<int> breakpoints(const ShardCurve& curve) {
+    Vector<int> points = {0};
+    for (size_t j = 1; j < curve.size(); j++) {
+        if (curve[j] != curve[j - 1]) {
+            points.add(int(j));
+        }
+    }
+    return points;
+}
+
+/* One full merge, planned so it can be split into tasks. A SMAWK merge
+ * is a single task, with steps the concave curve. A blocked merge is
+ * one task per output block, applying the breakpoints of steps to base.
+ * When the events behind the curves are known, a fold is often cheaper:
+ * the events of one side go into the other curve through the DP's row
+ * update, as a single task. Both cost about one pass over the row per
+ * event or breakpoint, and a shard usually has far fewer events than
+ * breakpoints, since every subset of its events can add a step. But the
+ * fold runs on one thread while the blocks spread over the
+ * threadsPerMerge this merge gets, so the fold is picked only when it
+ * still wins after that split.
+ */
+enum class MergeKind {
+    Concave,
+    Blocked,
+    Fold
+};
+
+struct PlannedMerge {
+    MergeKind kind;
+    const ShardCurve* base;
+    const ShardCurve* steps;
+    const Vector<pair<int, int>>* events;
+    Vector<int> points;
+    ShardCurve result;
+};
+
+static PlannedMerge planMerge(const ShardCurve& a, const ShardCurve& b, int threadsPerMerge = 1,
+                              const Vector<pair<int, int>>* eventsA = nullptr,
+                              const Vector<pair<int, int>>* eventsB = nullptr) {
+    PlannedMerge merge;
+    merge.events = nullptr;
+    if (isConcave(a) || isConcave(b)) {
+        merge.kind = MergeKind::Concave;
+        merge.base = isConcave(b) ? &a : &b;
+        merge.steps = isConcave(b) ? &b : &a;
+        return merge;
+    }
+    Vector<int> stepsA = breakpoints(a);
+    Vector<int> stepsB = breakpoints(b);
+    bool fewerInA = stepsA.size() <= stepsB.size();
+    merge.kind = MergeKind::Blocked;
+    merge.base = fewerInA ? &b : &a;
+    merge.steps = fewerInA ? &a : &b;
+    merge.points = fewerInA ? stepsA : stepsB;
+    if (eventsA != nullptr && eventsB != nullptr) {
+        bool foldA = eventsA->size() <= eventsB->size();
+        const Vector<pair<int, int>>* fewer = foldA ? eventsA : eventsB;
+        if ((long long)fewer->size() * threadsPerMerge < merge.points.size()) {
+            merge.kind = MergeKind::Fold;
+            merge.base = foldA ? &b : &a;
+            merge.events = fewer;
+            return merge;
+        }
+    }
+    merge.result.assign(a.size(), 0);
+    return merge;
+}
+
+/* Runs every task of every merge on the shared pool, handing them out
+ * through an atomic counter since blocks late in a curve see more
+ * breakpoints than early ones. The blocks go out last first, so the
+ * largest tasks start early and the small ones fill in at the end.
+ */
+static void runMerges(Vector<PlannedMerge>& merges) {
+    Vector<pair<int, int>> tasks;
+    for (int m = 0; m < merges.size(); m++) {
+        if (merges[m].kind != MergeKind::Blocked) {
+            tasks.add({m, -1});
+            continue;
+        }
+        int length = int(merges[m].result.size());
+        for (int lo = (length - 1) / MERGE_BLOCK * MERGE_BLOCK; lo >= 0; lo -= MERGE_BLOCK) {
+            tasks.add({m, lo});
+        }
+    }
+    int threads = max(1, min(ThreadPool::hardwareThreads(), tasks.size()));
+    atomic<int> next(0);
+    ThreadPool::shared().run(threads, [&](int) {
+        for (int t = next++; t < tasks.size(); t = next++) {
+            PlannedMerge& merge = merges[tasks[t].first];
+            int lo = tasks[t].second;
+            if (merge.kind == MergeKind::Concave) {
+                merge.result = concaveConvolve(*merge.base, *merge.steps);
+            }
+            else if (merge.kind == MergeKind::Fold) {
+                merge.result = *merge.base;
+                int money = int(merge.result.size()) - 1;
+                for (const pair<int, int>& event : *merge.events) {
+                    knapsackRowUpdate(merge.result.data(), money, event.second, uint32_t(event.first));
+                }
+            }
+            else {
+                int hi = min(int(merge.result.size()), lo + MERGE_BLOCK);
+                for (int j : merge.points) {
+                    if (j >= hi) {
+                        break;
+                    }
+                    knapsackShiftMax(merge.base->data(), merge.result.data(), lo, hi, j, (*merge.steps)[j]);
+                }
+            }
+        }
+    });
+}
+
+static long long peakMinutes(const ShardCurve& curve) {
+    return curve.empty() ? 0 : *max_element(curve.begin(), curve.end());
+}
+
+/* Full convolution of two curves over the same budget range, using
+ * SMAWK when either one is concave and the blocked kernel otherwise.
+ */
+ShardCurve maxPlusConvolve(const ShardCurve& a, const ShardCurve& b) {
+    if (a.size() != b.size()) {
+        error("maxPlusConvolve: curves must cover the same budgets");
+    }
+    if (peakMinutes(a) + peakMinutes(b) > UINT32_MAX) {
+        error("maxPlusConvolve: the merged minutes must fit in 32 bits");
+    }
+    Vector<PlannedMerge> merges;
+    merges.add(planMerge(a, b));
+    runMerges(merges);
+    return merges[0].result;
+}
+
+/* A single entry of the convolution, which is all the last merge needs. */
+long long maxPlusAt(const ShardCurve& a, const ShardCurve& b, int money) {
+    if (money < 0 || money >= int(a.size()) || money >= int(b.size())) {
+        error("maxPlusAt: budget is outside the curves");
+    }
+    long long best = 0;
+    for (int j = 0; j <= money; j++) {
+        best = max(best, (long long)(a[j]) + b[money - j]);
+    }
+    return best;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Curves are stored as a 4-byte tag, the number of entries, and then
+ * the raw uint32_t entries, so a shard computed by another process (or
+ * machine of the same endianness) can be merged here.
+ */
+
+static const char SHARD_TAG[4] = {'S', 'H', 'R', 'D'};
+
+void writeShardCurve(const ShardCurve& curve, const string& path) {
+    ofstream out(path, ios::binary);
+    uint32_t length = uint32_t(curve.size());
+    out.write(SHARD_TAG, sizeof(SHARD_TAG));
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(reinterpret_cast<const char*>(curve.data()), curve.size() * sizeof(uint32_t));
+    if (!out) {
+        error("writeShardCurve: could not write " + path);
+    }
+}
+
+ShardCurve readShardCurve(const string& path) {
+    ifstream in(path, ios::binary);
+    char tag[4];
+    uint32_t length = 0;
+    in.read(tag, sizeof(tag));
+    in.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (!in || !equal(tag, tag + 4, SHARD_TAG)) {
+        error("readShardCurve: " + path + " is not a shard curve file");
+    }
+    ShardCurve curve(length);
+    in.read(reinterpret_cast<char*>(curve.data()), length * sizeof(uint32_t));
+    if (!in) {
+        error("readShardCurve: " + path + " is truncated");
+    }
+    return curve;
+}
+
+/* Merges the curves pairwise in a tree, running all the merges of a
+ * level together on the pool, until two are left, and reads the answer
+ * off their merge at a single budget. groups, when given, holds the
+ * events behind each curve, so merges can fold them in instead. Every
+ * merged value is at most the sum of the curves' peaks, so checking
+ * that sum up front keeps the 32-bit entries from wrapping.
+ */
+static long long mergeCurves(vector<ShardCurve> curves, int money,
+                             const Vector<Vector<pair<int, int>>>* groups = nullptr) {
+    long long peak = 0;
+    for (const ShardCurve& curve : curves) {
+        peak += peakMinutes(curve);
+    }
+    if (peak > UINT32_MAX) {
+        error("mergeCurves: the merged minutes must fit in 32 bits");
+    }
+    Vector<Vector<pair<int, int>>> events;
+    if (groups != nullptr) {
+        events = *groups;
+    }
+    while (curves.size() > 2) {
+        int threadsPerMerge = max(1, ThreadPool::hardwareThreads() / int(curves.size() / 2));
+        Vector<PlannedMerge> merges;
+        for (size_t t = 0; t + 1 < curves.size(); t += 2) {
+            if (groups != nullptr) {
+                merges.add(planMerge(curves[t], curves[t + 1], threadsPerMerge, &events[t], &events[t + 1]));
+            }
+            else {
+                merges.add(planMerge(curves[t], curves[t + 1]));
+            }
+        }
+        runMerges(merges);
+        vector<ShardCurve> merged;
+        Vector<Vector<pair<int, int>>> mergedEvents;
+        for (size_t t = 0; t < curves.size(); t += 2) {
+            if (t + 1 == curves.size()) {
+                merged.push_back(std::move(curves[t]));
+            }
+            else {
+                merged.push_back(std::move(merges[t / 2].result));
+            }
+            if (groups != nullptr) {
+                Vector<pair<int, int>> node = events[t];
+                if (t + 1 < curves.size()) {
+                    for (const pair<int, int>& event : events[t + 1]) {
+                        node.add(event);
+                    }
+                }
+                mergedEvents.add(node);
+            }
+        }
+        curves = std::move(merged);
+        events = mergedEvents;
+    }
+    if (curves.size() == 1) {
+        return curves[0][money];
+    }
+    return maxPlusAt(curves[0], curves[1], money);
+}
+
+long long mergeShardFiles(const Vector<string>& paths, int money) {
+    if (paths.isEmpty()) {
+        return 0;
+    }
+    vector<ShardCurve> curves;
+    for (const string& path : paths) {
+        curves.push_back(readShardCurve(path));
+        if (money < 0 || money >= int(curves.back().size())) {
+            error("mergeShardFiles: " + path + " does not cover the budget");
+        }
+    }
+    return mergeCurves(move(curves), money);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Process mode forks one child per shard. The parent sizes every
+ * shard's arena before forking, so the children only run the DP kernel
+ * and write to their pipe; nothing in a child touches the allocator
+ * that another parent thread might have been holding at fork time.
+ * The parent reads the pipes in order, which is safe even though the
+ * curves are larger than a pipe buffer, since each child simply blocks
+ * on its write until its turn comes.
+ */
+
+#ifdef SHARDS_FORK
+static vector<ShardCurve> curvesFromProcesses(const Vector<Vector<pair<int, int>>>& groups, int money) {
+    int shards = groups.size();
+    vector<DPArena> arenas(shards);
+    for (DPArena& arena : arenas) {
+        arena.row<uint32_t>(money + 1);
+    }
+    vector<int> pipes;
+    vector<pid_t> children;
+    for (int t = 0; t < shards; t++) {
+        int ends[2];
+        if (pipe(ends) != 0) {
+            error("maxMinutesSharded: could not create a pipe");
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            error("maxMinutesSharded: could not fork a shard process");
+        }
+        if (pid == 0) {
+            close(ends[0]);
+            maxMinutesDPTyped<uint32_t>(groups[t], money, arenas[t]);
+            const char* data = reinterpret_cast<const char*>(arenas[t].row<uint32_t>(money + 1));
+            size_t left = size_t(money + 1) * sizeof(uint32_t);
+            while (left > 0) {
+                ssize_t wrote = write(ends[1], data, left);
+                if (wrote <= 0) {
+                    _exit(1);
+                }
+                data += wrote;
+                left -= size_t(wrote);
+            }
+            _exit(0);
+        }
+        close(ends[1]);
+        pipes.push_back(ends[0]);
+        children.push_back(pid);
+    }
+    vector<ShardCurve> curves(shards, ShardCurve(money + 1));
+    bool failed = false;
+    for (int t = 0; t < shards; t++) {
+        char* data = reinterpret_cast<char*>(curves[t].data());
+        size_t left = size_t(money + 1) * sizeof(uint32_t);
+        while (left > 0) {
+            ssize_t got = read(pipes[t], data, left);
+            if (got <= 0) {
+                failed = true;
+                break;
+            }
+            data += got;
+            left -= size_t(got);
+        }
+        close(pipes[t]);
+        int status = 0;
+        waitpid(children[t], &status, 0);
+        failed = failed || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    if (failed) {
+        error("maxMinutesSharded: a shard process failed");
+    }
+    return curves;
+}
+#endif
+
+/* Main entry point. Process mode falls back to threads on platforms
+ * without fork. Every shard curve and every merge is bounded by the
+ * total duration of all the events, so that total is checked here, on
+ * the calling thread, before any shard runs; when it does not fit the
+ * 32-bit curves, the whole problem goes to maxMinutesDP, which picks
+ * rows wide enough for it. That also keeps shardCurve's own check from
+ * ever firing inside a pool task or a forked child.
+ */
+long long maxMinutesSharded(const Vector<pair<int, int>>& events, int money, int shards, ShardMode mode) {
+    if (money < 0) {
+        return 0;
+    }
+    long long total = 0;
+    for (const pair<int, int>& event : events) {
+        if (event.first < 0 || event.second < 0) {
+            error("maxMinutesSharded: event durations and costs must be non-negative");
+        }
+        total += event.first;
+    }
+    if (total > UINT32_MAX) {
+        DPArena arena;
+        return maxMinutesDP(events, money, arena);
+    }
+    shards = max(1, min(shards, events.size()));
+    Vector<Vector<pair<int, int>>> groups(shards);
+    for (int i = 0; i < events.size(); i++) {
+        groups[i % shards].add(events[i]);
+    }
+    vector<ShardCurve> curves(shards);
+#ifdef SHARDS_FORK
+    if (mode == ShardMode::Processes) {
+        curves = curvesFromProcesses(groups, money);
+        return mergeCurves(move(curves), money, &groups);
+    }
+#endif
+    ThreadPool::shared().run(shards, [&](int t) {
+        curves[t] = shardCurve(groups[t], money);
+    });
+    return mergeCurves(move(curves), money, &groups);
+}
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+/* Straightforward O(m^2) convolution to check the fast merges against. */
+static ShardCurve naiveConvolve(const ShardCurve& a, const ShardCurve& b) {
+    ShardCurve result(a.size(), 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        for (size_t j = 0; j <= i; j++) {
+            result[i] = max(result[i], a[j] + b[i - j]);
+        }
+    }
+    return result;
+}
+
+static Vector<pair<int, int>> randomEvents(int n, int maxCost) {
+    Vector<pair<int, int>> events;
+    for (int i = 0; i < n; i++) {
+        events.add({randomInteger(0, 150), randomInteger(0, maxCost)});
+    }
+    return events;
+}
+
+STUDENT_TEST("(max,+) merges match the naive convolution") {
+    for (int trial = 0; trial < 20; trial++) {
+        int money = randomInteger(0, 400);
+        ShardCurve a = shardCurve(randomEvents(randomInteger(0, 20), 100), money);
+        ShardCurve b = shardCurve(randomEvents(randomInteger(0, 20), 100), money);
+        EXPECT(maxPlusConvolve(a, b) == naiveConvolve(a, b));
+        EXPECT_EQUAL(maxPlusAt(a, b, money), naiveConvolve(a, b)[money]);
+
+        // Concave curves take the SMAWK path
+        ShardCurve concave(money + 1);
+        int slope1 = randomInteger(3, 9);
+        int knee = randomInteger(0, 200);
+        for (int j = 0; j <= money; j++) {
+            concave[j] = uint32_t(min(slope1 * j, slope1 * knee + (j - knee)));
+        }
+        EXPECT(isConcave(concave));
+        EXPECT(maxPlusConvolve(a, concave) == naiveConvolve(a, concave));
+        EXPECT(maxPlusConvolve(concave, b) == naiveConvolve(concave, b));
+    }
+    EXPECT(!isConcave({0, 1, 3}));
+}
+
+STUDENT_TEST("Sharded solves match maxMinutesDP with threads, processes and files") {
+    for (int shards = 1; shards <= 5; shards++) {
+        Vector<pair<int, int>> musicEvents = randomEvents(40, 300);
+        int money = randomInteger(0, 2000);
+        long long expected = maxMinutesDP(musicEvents, money);
+        EXPECT_EQUAL(maxMinutesSharded(musicEvents, money, shards), expected);
+        EXPECT_EQUAL(maxMinutesSharded(musicEvents, money, shards, ShardMode::Processes), expected);
+    }
+    EXPECT_EQUAL(maxMinutesSharded({}, 20, 3), 0);
+
+    Vector<pair<int, int>> musicEvents = randomEvents(30, 300);
+    Vector<string> paths;
+    for (int t = 0; t < 3; t++) {
+        Vector<pair<int, int>> shard;
+        for (int i = t; i < musicEvents.size(); i += 3) {
+            shard.add(musicEvents[i]);
+        }
+        paths.add("shard-test-" + to_string(t) + ".bin");
+        writeShardCurve(shardCurve(shard, 1000), paths[t]);
+    }
+    EXPECT_EQUAL(mergeShardFiles(paths, 1000), maxMinutesDP(musicEvents, 1000));
+    EXPECT_EQUAL(mergeShardFiles(paths, 500), maxMinutesDP(musicEvents, 500));
+    for (const string& path : paths) {
+        remove(path.c_str());
+    }
+    EXPECT_ERROR(readShardCurve("shard-test-missing.bin"));
+
+    // Totals beyond 32 bits, whether one shard's or only the merge's,
+    // are solved with wide rows in either mode
+    Vector<pair<int, int>> long3 = {{2000000000, 1}, {2000000000, 1}, {2000000000, 1}};
+    Vector<pair<int, int>> mixed = {{1, 1}, {2000000000, 1}, {1, 1}, {2000000000, 1}, {1, 1}, {2000000000, 1}};
+    for (ShardMode mode : {ShardMode::Threads, ShardMode::Processes}) {
+        for (int shards = 1; shards <= 3; shards++) {
+            EXPECT_EQUAL(maxMinutesSharded(long3, 3, shards, mode), 6000000000LL);
+            EXPECT_EQUAL(maxMinutesSharded(mixed, 6, shards, mode), 6000000003LL);
+        }
+    }
+    EXPECT_ERROR(shardCurve(long3, 3));
+    EXPECT_ERROR(maxPlusConvolve({0, 3000000000u}, {0, 3000000000u}));
+}
+
+STUDENT_TEST("Time trials on sharded solves against a single maxMinutesDP") {
+    Vector<pair<int, int>> musicEvents = randomEvents(2000, 5000);
+    int money = 400000;
+    TIME_OPERATION(1, maxMinutesDP(musicEvents, money));
+    for (int shards = 2; shards <= 8; shards *= 2) {
+        TIME_OPERATION(shards, maxMinutesSharded(musicEvents, money, shards));
+    }
+    TIME_OPERATION(2, maxMinutesSharded(musicEvents, money, 2, ShardMode::Processes));
+
+    ShardCurve a = shardCurve(randomEvents(20, 5000), 50000);
+    ShardCurve b = shardCurve(randomEvents(20, 5000), 50000);
+    ShardCurve concave(50001);
+    for (int j = 0; j <= 50000; j++) {
+        concave[j] = uint32_t(min(4 * j, 20000 + j));
+    }
+    TIME_OPERATION(50000, maxPlusConvolve(a, b));
+    TIME_OPERATION(50000, maxPlusConvolve(a, concave));
+}
@@ -0,0 +1,42 @@
+#ifndef SHARDEDKNAPSACK_H
+#define SHARDEDKNAPSACK_H
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "vector.h"
+
+/* The best minutes for every budget 0..money using only one shard of
+ * the events, i.e. the final row of maxMinutesDP over that shard.
+ */
+typedef std::vector<uint32_t> ShardCurve;
+
+/* Where the shard curves are computed: on the shared thread pool, or in
+ * forked child processes that send their curves back through pipes.
+ */
+enum class ShardMode {
+    Threads,
+    Processes
+};
+
+ShardCurve shardCurve(const Vector<std::pair<int, int>>& events, int money);
+bool isConcave(const ShardCurve& curve);
+ShardCurve maxPlusConvolve(const ShardCurve& a, const ShardCurve& b);
+long long maxPlusAt(const ShardCurve& a, const ShardCurve& b, int money);
+
+void writeShardCurve(const ShardCurve& curve, const std::string& path);
+ShardCurve readShardCurve(const std::string& path);
+long long mergeShardFiles(const Vector<std::string>& paths, int money);
+
+/* maxMinutesDP computed as k independent shards merged together. The
+ * shards can run in separate processes, or on separate machines through
+ * shard curve files, but in one process the merges keep it from beating
+ * maxMinutesDP on one core, and from doing much better than twice as
+ * fast on many; see shardedknapsack.cpp.
+ */
+long long maxMinutesSharded(const Vector<std::pair<int, int>>& events, int money, int shards,
+                            ShardMode mode = ShardMode::Threads);
+
+#endif // SHARDEDKNAPSACK_H
@@ -0,0 +1,158 @@
+#include "threadpool.h"
+#include <chrono>
+#include "error.h"
+#include "testing/SimpleTest.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int numThreads) {
+    grow(numThreads);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(stateLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/* Counts the calling thread, so a pool of size n owns n - 1 workers. */
+int ThreadPool::size() const {
+    return int(workers.size()) + 1;
+}
+
+/* Process-wide pool shared by the parallel solvers. */
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(hardwareThreads());
+    return pool;
+}
+
+int ThreadPool::hardwareThreads() {
+    return max(1, int(thread::hardware_concurrency()));
+}
+
+void ThreadPool::grow(int numThreads) {
+    lock_guard<mutex> guard(stateLock);
+    while (size() < numThreads) {
+        int id = size();
+        workers.emplace_back(&ThreadPool::workerLoop, this, id);
+    }
+}
+
+/* Runs task(0) here and task(t) on worker t for 0 < t < numTasks.
+ * Concurrent callers are serialized, since every task needs its own
+ * thread for barrier-based algorithms to make progress. The workers are
+ * always waited for, even when task(0) throws, since they are still
+ * calling task, and the first exception from any task is rethrown once
+ * they are done.
+ */
+void ThreadPool::run(int numTasks, const function<void(int)>& task) {
+    lock_guard<mutex> serial(runLock);
+    grow(numTasks);
+    {
+        lock_guard<mutex> guard(stateLock);
+        job = &task;
+        jobTasks = numTasks;
+        pending = numTasks - 1;
+        failure = nullptr;
+        generation++;
+    }
+    wake.notify_all();
+    exception_ptr own;
+    try {
+        task(0);
+    }
+    catch (...) {
+        own = current_exception();
+    }
+    unique_lock<mutex> guard(stateLock);
+    finished.wait(guard, [this] { return pending == 0; });
+    job = nullptr;
+    exception_ptr first = own ? own : failure;
+    failure = nullptr;
+    guard.unlock();
+    if (first) {
+        rethrow_exception(first);
+    }
+}
+
+void ThreadPool::workerLoop(int id) {
+    long seen = 0;
+    while (true) {
+        const function<void(int)>* task;
+        {
+            unique_lock<mutex> guard(stateLock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            if (id >= jobTasks) {
+                continue;
+            }
+            task = job;
+        }
+        exception_ptr thrown;
+        try {
+            (*task)(id);
+        }
+        catch (...) {
+            thrown = current_exception();
+        }
+        {
+            lock_guard<mutex> guard(stateLock);
+            if (thrown && !failure) {
+                failure = thrown;
+            }
+            pending--;
+        }
+        finished.notify_one();
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+SpinBarrier::SpinBarrier(int numThreads) : threads(numThreads), waiting(0), phase(0) {}
+
+void SpinBarrier::wait() {
+    int current = phase.load(memory_order_acquire);
+    if (waiting.fetch_add(1, memory_order_acq_rel) == threads - 1) {
+        waiting.store(0, memory_order_relaxed);
+        phase.fetch_add(1, memory_order_release);
+        return;
+    }
+    for (int spins = 0; phase.load(memory_order_acquire) == current; spins++) {
+        if (spins >= 256) {
+            this_thread::yield();
+        }
+    }
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+STUDENT_TEST("ThreadPool rethrows a task's error on the caller and stays usable") {
+    ThreadPool pool(4);
+    for (int thrower = 0; thrower < 4; thrower++) {
+        atomic<int> finished(0);
+        EXPECT_ERROR(pool.run(4, [&](int t) {
+            if (t == thrower) {
+                error("task failed");
+            }
+            this_thread::sleep_for(chrono::milliseconds(5));
+            finished++;
+        }));
+        /* Every other task ran to the end before run returned */
+        EXPECT_EQUAL(finished.load(), 3);
+    }
+
+    atomic<int> sum(0);
+    pool.run(4, [&](int t) {
+        sum += t;
+    });
+    EXPECT_EQUAL(sum.load(), 6);
+}
@@ -0,0 +1,163 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A persistent pool of worker threads. run(n, task) calls task(0) on
+ * the calling thread and task(1) .. task(n - 1) on n - 1 distinct
+ * workers, then waits for all of them, so every task is guaranteed its
+ * own thread and tasks may synchronize with each other through a
+ * SpinBarrier. Worker t always runs task t, which lets callers give
+ * each thread a fixed slice of memory across many calls. The pool
+ * grows on demand and its threads are only joined on destruction.
+ *
+ * If tasks throw, run still waits for every task of the call to return
+ * and then rethrows the first exception on the calling thread, so
+ * errors raised inside a task reach the caller like any other error.
+ * Tasks that meet at a SpinBarrier must not throw between barriers,
+ * since the others would wait there forever.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(int numThreads = 1);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const;
+    void run(int numTasks, const std::function<void(int)>& task);
+
+    static ThreadPool& shared();
+    static int hardwareThreads();
+
+private:
+    void grow(int numThreads);
+    void workerLoop(int id);
+
+    std::vector<std::thread> workers;
+    std::mutex runLock;
+    std::mutex stateLock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int)>* job = nullptr;
+    int jobTasks = 0;
+    int pending = 0;
+    long generation = 0;
+    std::exception_ptr failure;
+    bool stopping = false;
+};
+
+/* A phase-counter barrier for a fixed number of threads: the last
+ * thread to arrive resets the arrival count and advances the phase,
+ * which releases the others, who wait for the phase they arrived in to
+ * change. Waiters spin briefly and then yield, which keeps the per-event barrier in the
+ * parallel DP cheap without starving oversubscribed machines.
+ */
+class SpinBarrier {
+public:
+    explicit SpinBarrier(int numThreads);
+    void wait();
+
+private:
+    const int threads;
+    std::atomic<int> waiting;
+    std::atomic<int> phase;
+};
+
+/* Work-stealing scheduler for irregular recursive work on a ThreadPool.
+ * Each worker pushes and pops tasks at the back of its own deque, which
+ * keeps it depth-first on recent, cache-warm work, and steals from the
+ * front of another worker's deque when its own runs dry, which takes
+ * the oldest and usually largest pending subtree. The run finishes once
+ * every task pushed, including those pushed by other tasks, has been
+ * processed. The deques are guarded by short per-worker locks, since
+ * tasks here are whole subtrees and far outweigh the locking.
+ */
+template <typename Task>
+class WorkStealingQueue {
+public:
+    explicit WorkStealingQueue(int numWorkers) : queues(numWorkers), outstanding(0) {}
+
+    int workers() const {
+        return int(queues.size());
+    }
+
+    void push(int worker, const Task& task) {
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> guard(queues[worker].lock);
+        queues[worker].tasks.push_back(task);
+    }
+
+    /* Number of tasks waiting in this worker's own deque, so a task can
+     * decide whether splitting off more work is worthwhile.
+     */
+    size_t backlog(int worker) {
+        std::lock_guard<std::mutex> guard(queues[worker].lock);
+        return queues[worker].tasks.size();
+    }
+
+    /* Calls process(worker, task) for every task until none remain. */
+    void run(ThreadPool& pool, const std::function<void(int, Task&)>& process) {
+        pool.run(workers(), [&](int worker) {
+            Task task;
+            int victim = worker;
+            while (outstanding.load(std::memory_order_acquire) > 0) {
+                if (popOwn(worker, task) || steal(worker, victim, task)) {
+                    process(worker, task);
+                    outstanding.fetch_sub(1, std::memory_order_acq_rel);
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+private:
+    struct alignas(64) WorkerQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    bool popOwn(int worker, Task& task) {
+        std::lock_guard<std::mutex> guard(queues[worker].lock);
+        if (queues[worker].tasks.empty()) {
+            return false;
+        }
+        task = queues[worker].tasks.back();
+        queues[worker].tasks.pop_back();
+        return true;
+    }
+
+    /* Tries every other worker once, starting after the last victim that
+     * had work, so thieves spread out instead of all hitting worker 0.
+     */
+    bool steal(int worker, int& victim, Task& task) {
+        for (int tries = 0; tries < workers(); tries++) {
+            victim = (victim + 1) % workers();
+            if (victim == worker) {
+                continue;
+            }
+            std::lock_guard<std::mutex> guard(queues[victim].lock);
+            if (!queues[victim].tasks.empty()) {
+                task = queues[victim].tasks.front();
+                queues[victim].tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<WorkerQueue> queues;
+    std::atomic<long long> outstanding;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,607 @@
+#include "corpusanalyzer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "error.h"
+#include "modulate.h"
+#include "modulationcache.h"
+#include "testinputs.h"
+#include "testing/SimpleTest.h"
+
+using namespace std;
+
+/* Bytes of corpus read and shared out at a time. */
+static const size_t BLOCK_BYTES = 1 << 22;
+
+/* Pieces of each block per worker, so a worker that draws short lines
+ * can take more of them.
+ */
+static const int CHUNKS_PER_THREAD = 8;
+
+void CorpusStats::add(const CorpusStats& other) {
+    pieces += other.pieces;
+    transitions += other.transitions;
+    unreachable += other.unreachable;
+    totalDistance += other.totalDistance;
+    for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+        relationUses[relation] += other.relationUses[relation];
+    }
+}
+
+/* The distance and the relations used along the shortest path between
+ * every pair of keys, so each transition in the corpus costs a lookup.
+ * The paths are those of modulateBFS, read from the shared cache.
+ */
+struct TransitionTable {
+    int8_t distance[NUM_KEYS][NUM_KEYS];
+    uint8_t uses[NUM_KEYS][NUM_KEYS][NUM_RELATIONS];
+};
+
+static void fillTransitionTable(TransitionTable& table, int allowed) {
+    memset(&table, 0, sizeof(table));
+    for (KeyId start = 0; start < NUM_KEYS; start++) {
+        for (KeyId end = 0; end < NUM_KEYS; end++) {
+            Vector<KeyId> path = ModulationCache::shared().path(start, end, allowed);
+            table.distance[start][end] = int8_t(path.size() - 1);
+            for (int i = 1; i < path.size(); i++) {
+                for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+                    if ((allowed & (1 << relation)) && relatedKey(path[i - 1], relation) == path[i]) {
+                        table.uses[start][end][relation]++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Appends the decimal digits of value to out. */
+static void appendNumber(string& out, long long value) {
+    char digits[24];
+    int length = snprintf(digits, sizeof(digits), "%lld", value);
+    out.append(digits, length);
+}
+
+/* Analyzes the whole lines in [begin, end), appending a report line for
+ * each piece to out and adding to totals. Keys are parsed in place and
+ * looked up in the table, so nothing is allocated once out has grown to
+ * size. On a bad key, failure is set and the rest of the lines are
+ * skipped.
+ */
+static void analyzeLines(const char* begin, const char* end, const TransitionTable& table, string& out,
+                         CorpusStats& totals, string& failure) {
+    for (const char* line = begin; line < end;) {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (lineEnd == nullptr) {
+            lineEnd = end;
+        }
+        const char* next = lineEnd + 1;
+        if (lineEnd > line && lineEnd[-1] == '\r') {
+            lineEnd--;
+        }
+        const char* at = line;
+        while (at < lineEnd && (*at == ' ' || *at == '\t')) {
+            at++;
+        }
+        if (at == lineEnd || *at == '#') {
+            line = next;
+            continue;
+        }
+
+        const char* nameEnd = static_cast<const char*>(memchr(at, ',', lineEnd - at));
+        if (nameEnd == nullptr) {
+            nameEnd = lineEnd;
+        }
+        CorpusStats piece;
+        piece.pieces = 1;
+        int keys = 0;
+        KeyId previous = -1;
+        for (const char* field = nameEnd; field < lineEnd;) {
+            field++;
+            const char* fieldEnd = static_cast<const char*>(memchr(field, ',', lineEnd - field));
+            if (fieldEnd == nullptr) {
+                fieldEnd = lineEnd;
+            }
+            const char* first = field;
+            const char* last = fieldEnd;
+            while (first < last && (*first == ' ' || *first == '\t')) {
+                first++;
+            }
+            while (last > first && (last[-1] == ' ' || last[-1] == '\t')) {
+                last--;
+            }
+            KeyId key = keyIdAt(first, last - first);
+            if (key < 0) {
+                failure = "analyzeCorpus: piece \"" + string(at, nameEnd) + "\" has \"" + string(first, last) +
+                          "\", which is not a major or minor key";
+                return;
+            }
+            if (previous >= 0) {
+                piece.transitions++;
+                int distance = table.distance[previous][key];
+                if (distance < 0) {
+                    piece.unreachable++;
+                }
+                else {
+                    piece.totalDistance += distance;
+                    for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+                        piece.relationUses[relation] += table.uses[previous][key][relation];
+                    }
+                }
+            }
+            previous = key;
+            keys++;
+            field = fieldEnd;
+        }
+
+        out.append(at, nameEnd);
+        for (long long value : {(long long)keys, piece.transitions, piece.totalDistance, piece.unreachable}) {
+            out += ',';
+            appendNumber(out, value);
+        }
+        for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+            out += ',';
+            appendNumber(out, piece.relationUses[relation]);
+        }
+        out += '\n';
+        totals.add(piece);
+        line = next;
+    }
+}
+
+/* One block of the corpus: the text read, of which [0, cut) is whole
+ * lines and the rest is carried into the next block, the chunks those
+ * lines are split into, and each chunk's report, totals and failure.
+ * The buffers are kept from block to block.
+ */
+struct CorpusBlock {
+    string text;
+    size_t cut = 0;
+    bool last = false;
+    vector<const char*> cuts;
+    vector<string> outputs;
+    vector<CorpusStats> totals;
+    vector<string> failures;
+};
+
+/* Reads the next block into block, after the carried bytes, which end
+ * the previous block and so hold no newline. A line longer than a block
+ * is read on until it ends. The whole lines are then split into
+ * numChunks chunks at line boundaries.
+ */
+static void readBlock(istream& corpus, CorpusBlock& block, const char* carried, size_t carriedSize, int numChunks) {
+    block.text.assign(carried, carriedSize);
+    size_t size = carriedSize;
+    while (true) {
+        block.text.resize(size + BLOCK_BYTES);
+        corpus.read(&block.text[size], BLOCK_BYTES);
+        size += corpus.gcount();
+        block.last = size_t(corpus.gcount()) < BLOCK_BYTES;
+        size_t newline = block.text.rfind('\n', size - 1);
+        if (block.last || (size > 0 && newline != string::npos)) {
+            block.cut = block.last ? size : newline + 1;
+            break;
+        }
+    }
+    block.text.resize(size);
+
+    const char* begin = block.text.data();
+    block.cuts.resize(numChunks + 1);
+    block.outputs.resize(numChunks);
+    block.totals.resize(numChunks);
+    block.failures.resize(numChunks);
+    block.cuts[0] = begin;
+    for (int chunk = 1; chunk < numChunks; chunk++) {
+        const char* at = max(block.cuts[chunk - 1], begin + block.cut * chunk / numChunks);
+        const char* newline = static_cast<const char*>(memchr(at, '\n', begin + block.cut - at));
+        block.cuts[chunk] = newline == nullptr ? begin + block.cut : newline + 1;
+    }
+    block.cuts[numChunks] = begin + block.cut;
+}
+
+/* Workers that stay alive for a whole analyzeCorpus run. start() hands
+ * them a block, whose chunks they take in turn from a shared counter;
+ * finish() has the caller take chunks too until none are left, then
+ * waits for the workers to finish theirs. In between, the caller is free
+ * to read the next block. A worker takes chunks only from the block it
+ * was handed under the lock, and the counter is only reset once every
+ * worker holding a block has let go of it, so a worker that wakes late
+ * finds no chunks left rather than one of the next block's.
+ */
+class ChunkWorkers {
+public:
+    ChunkWorkers(int numWorkers, const TransitionTable& table) : table(table) {
+        for (int worker = 0; worker < numWorkers; worker++) {
+            workers.emplace_back(&ChunkWorkers::workerLoop, this);
+        }
+    }
+
+    ~ChunkWorkers() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void start(CorpusBlock& block) {
+        {
+            unique_lock<mutex> guard(lock);
+            done.wait(guard, [this] { return active == 0; });
+            current = &block;
+            numChunks = int(block.outputs.size());
+            nextChunk = 0;
+            finished = 0;
+            generation++;
+        }
+        wake.notify_all();
+    }
+
+    void finish() {
+        analyzeChunks(*current, numChunks);
+        unique_lock<mutex> guard(lock);
+        done.wait(guard, [this] { return finished == numChunks && active == 0; });
+    }
+
+private:
+    void analyzeChunks(CorpusBlock& block, int chunks) {
+        for (int chunk; (chunk = nextChunk++) < chunks;) {
+            block.outputs[chunk].clear();
+            block.totals[chunk] = CorpusStats();
+            analyzeLines(block.cuts[chunk], block.cuts[chunk + 1], table, block.outputs[chunk], block.totals[chunk],
+                         block.failures[chunk]);
+            lock_guard<mutex> guard(lock);
+            finished++;
+        }
+    }
+
+    void workerLoop() {
+        long seen = 0;
+        while (true) {
+            CorpusBlock* block;
+            int chunks;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                block = current;
+                chunks = numChunks;
+                active++;
+            }
+            analyzeChunks(*block, chunks);
+            {
+                lock_guard<mutex> guard(lock);
+                active--;
+            }
+            done.notify_all();
+        }
+    }
+
+    const TransitionTable& table;
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake;
+    condition_variable done;
+    CorpusBlock* current = nullptr;
+    int numChunks = 0;
+    atomic<int> nextChunk{0};
+    int finished = 0;
+    int active = 0;
+    long generation = 0;
+    bool stopping = false;
+};
+
+/* Streams the corpus a block at a time through threads - 1 workers and
+ * the calling thread. While the workers analyze one block the caller
+ * reads the next into a second buffer, then joins in on the rest of the
+ * first. Each chunk's report goes into its own buffer, and the buffers
+ * are written out in order, so the report does not depend on the number
+ * of threads.
+ */
+CorpusStats analyzeCorpus(istream& corpus, ostream& report, const Set<int>& allowed, int threads) {
+    if (threads <= 0) {
+        threads = max(1, int(thread::hardware_concurrency()));
+    }
+    TransitionTable table;
+    fillTransitionTable(table, allowedMask(allowed));
+    report << "piece,keys,transitions,distance,unreachable,"
+           << "parallel,supertonic,mediant,subdominant,dominant,relative\n";
+
+    int numChunks = threads * CHUNKS_PER_THREAD;
+    CorpusBlock blocks[2];
+    ChunkWorkers workers(threads - 1, table);
+    CorpusStats totals;
+    readBlock(corpus, blocks[0], nullptr, 0, numChunks);
+    for (int index = 0;; index ^= 1) {
+        CorpusBlock& block = blocks[index];
+        CorpusBlock& next = blocks[index ^ 1];
+        workers.start(block);
+        if (!block.last) {
+            readBlock(corpus, next, block.text.data() + block.cut, block.text.size() - block.cut, numChunks);
+        }
+        workers.finish();
+
+        for (int chunk = 0; chunk < numChunks; chunk++) {
+            if (!block.failures[chunk].empty()) {
+                error(block.failures[chunk]);
+            }
+            report.write(block.outputs[chunk].data(), block.outputs[chunk].size());
+            totals.add(block.totals[chunk]);
+        }
+        if (block.last) {
+            break;
+        }
+    }
+    return totals;
+}
+
+CorpusStats analyzeCorpusFile(const string& corpusPath, const string& reportPath, const Set<int>& allowed,
+                              int threads) {
+    ifstream corpus(corpusPath, ios::binary);
+    if (!corpus) {
+        error("analyzeCorpus: cannot open " + corpusPath);
+    }
+    ofstream report(reportPath, ios::binary);
+    if (!report) {
+        error("analyzeCorpus: cannot write " + reportPath);
+    }
+    return analyzeCorpus(corpus, report, allowed, threads);
+}
+
+/* Parses a --threads value, a whole number of threads, 0 for all. */
+static int parseThreads(const string& value) {
+    size_t used = 0;
+    int threads = -1;
+    try {
+        threads = stoi(value, &used);
+    }
+    catch (const exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size() || threads < 0) {
+        error("analyze-corpus: \"" + value + "\" is not a number of threads");
+    }
+    return threads;
+}
+
+/* Parses a comma-separated list of relation numbers. */
+static Set<int> parseRelations(const string& list) {
+    Set<int> relations;
+    istringstream in(list);
+    string item;
+    while (getline(in, item, ',')) {
+        size_t used = 0;
+        int relation = -1;
+        try {
+            relation = stoi(item, &used);
+        }
+        catch (const exception&) {
+            used = 0;
+        }
+        if (used == 0 || used != item.size() || relation < 0 || relation >= NUM_RELATIONS) {
+            error("analyze-corpus: \"" + item + "\" is not a relation from 0 to 5");
+        }
+        relations.add(relation);
+    }
+    return relations;
+}
+
+int corpusAnalyzerMain(int argc, char* argv[]) {
+    Vector<string> paths;
+    Set<int> allowed = {0, 1, 2, 3, 4, 5};
+    int threads = 0;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if ((arg == "--allowed" || arg == "--threads") && i + 1 < argc) {
+                string value = argv[++i];
+                if (arg == "--allowed") {
+                    allowed = parseRelations(value);
+                }
+                else {
+                    threads = parseThreads(value);
+                }
+            }
+            else if (arg.rfind("--", 0) == 0) {
+                paths.clear();
+                break;
+            }
+            else {
+                paths.add(arg);
+            }
+        }
+        if (paths.size() != 2) {
+            cerr << "usage: analyze-corpus <corpus> <report> [--allowed 0,1,2,3,4,5] [--threads n]" << endl;
+            return 2;
+        }
+        auto begin = chrono::steady_clock::now();
+        CorpusStats totals = analyzeCorpusFile(paths[0], paths[1], allowed, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        cout << totals.pieces << " pieces, " << totals.transitions << " transitions, " << totals.totalDistance
+             << " modulations, " << totals.unreachable << " unreachable, "
+             << (long long)(totals.transitions / max(seconds, 1e-9)) << " transitions per second" << endl;
+    }
+    catch (const ErrorException& e) {
+        cerr << e.getMessage() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+/* * * * * * * * * * Test cases below this point * * * * * * * * * */
+
+STUDENT_TEST("Corpus statistics match modulateBFS for every transition") {
+    string corpus =
+        "# name, then keys\n"
+        "Prelude, C major, G major, E minor, C major\r\n"
+        "\n"
+        "  Fugue,Bb minor,C# major ,  Bb minor\n"
+        "Solo, D major\n"
+        "Untitled\n"
+        "Wanderer, C major, F# major, C major";
+    Set<int> allowed = {0, 1, 2, 3, 4, 5};
+    for (int threads = 1; threads <= 4; threads++) {
+        istringstream in(corpus);
+        ostringstream report;
+        CorpusStats totals = analyzeCorpus(in, report, allowed, threads);
+        EXPECT_EQUAL(report.str(),
+                     "piece,keys,transitions,distance,unreachable,parallel,supertonic,mediant,subdominant,dominant,relative\n"
+                     "Prelude,4,3,3,0,0,0,1,0,1,1\n"
+                     "Fugue,3,2,2,0,0,0,0,0,0,2\n"
+                     "Solo,1,0,0,0,0,0,0,0,0,0\n"
+                     "Untitled,0,0,0,0,0,0,0,0,0,0\n"
+                     "Wanderer,3,2,8,0,3,0,1,1,1,2\n");
+        EXPECT_EQUAL(totals.pieces, 5);
+        EXPECT_EQUAL(totals.transitions, 7);
+        EXPECT_EQUAL(totals.totalDistance, 13);
+    }
+
+    /* Distances agree with modulateBFS, and restricted relations leave
+     * some transitions unreachable
+     */
+    ostringstream pairs;
+    for (KeyId start = 0; start < NUM_KEYS; start++) {
+        pairs << "from " << start << ", " << keyName(start);
+        for (KeyId end = 0; end < NUM_KEYS; end++) {
+            pairs << ", " << keyName(end) << ", " << keyName(start);
+        }
+        pairs << "\n";
+    }
+    for (Set<int> relations : {Set<int>{0, 1, 2, 3, 4, 5}, Set<int>{3, 5}, Set<int>{1}}) {
+        long long distance = 0;
+        long long unreachable = 0;
+        for (KeyId start = 0; start < NUM_KEYS; start++) {
+            for (KeyId end = 0; end < NUM_KEYS; end++) {
+                for (int way = 0; way < 2; way++) {
+                    int size = way == 0 ? modulateBFS(keyName(start), keyName(end), relations).size()
+                                        : modulateBFS(keyName(end), keyName(start), relations).size();
+                    distance += max(size - 1, 0);
+                    unreachable += size == 0;
+                }
+            }
+        }
+        istringstream in(pairs.str());
+        ostringstream report;
+        CorpusStats totals = analyzeCorpus(in, report, relations, 3);
+        EXPECT_EQUAL(totals.transitions, 2 * NUM_KEYS * NUM_KEYS);
+        EXPECT_EQUAL(totals.totalDistance, distance);
+        EXPECT_EQUAL(totals.unreachable, unreachable);
+        long long uses = 0;
+        for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+            EXPECT(relations.contains(relation) || totals.relationUses[relation] == 0);
+            uses += totals.relationUses[relation];
+        }
+        EXPECT_EQUAL(uses, distance);
+    }
+
+    /* A piece longer than a block is read on until it ends */
+    string longPiece = "Endless";
+    while (longPiece.size() < 3 * BLOCK_BYTES) {
+        longPiece += ", C major, G major";
+    }
+    for (int threads = 1; threads <= 3; threads++) {
+        istringstream in("Short, C major, A minor\n" + longPiece + "\nShort, C major, C minor");
+        ostringstream report;
+        CorpusStats totals = analyzeCorpus(in, report, allowed, threads);
+        EXPECT_EQUAL(totals.pieces, 3);
+        EXPECT_EQUAL(totals.totalDistance, totals.transitions);
+    }
+
+    istringstream bad("Fine, C major\nBroken, C major, H minor\n");
+    ostringstream report;
+    EXPECT_ERROR(analyzeCorpus(bad, report, allowed));
+}
+
+STUDENT_TEST("The command-line stage reads a corpus file and writes a report file") {
+    string corpus = generatedCorpus(200000, 7);
+    ofstream("corpus-test.csv", ios::binary) << corpus;
+    char program[] = "analyze-corpus";
+    char input[] = "corpus-test.csv";
+    char output[] = "corpus-report.csv";
+    char allowedFlag[] = "--allowed";
+    char allowedList[] = "3,4,5";
+    char threadsFlag[] = "--threads";
+    char threadCount[] = "3";
+    char* argv[] = {program, input, output, allowedFlag, allowedList, threadsFlag, threadCount};
+    EXPECT_EQUAL(corpusAnalyzerMain(7, argv), 0);
+
+    istringstream in(corpus);
+    ostringstream expected;
+    analyzeCorpus(in, expected, {3, 4, 5}, 1);
+    ifstream written("corpus-report.csv", ios::binary);
+    EXPECT(string(istreambuf_iterator<char>(written), istreambuf_iterator<char>()) == expected.str());
+
+    EXPECT_EQUAL(corpusAnalyzerMain(2, argv), 2);
+    char badCount[] = "abc";
+    argv[6] = badCount;
+    EXPECT_EQUAL(corpusAnalyzerMain(7, argv), 1);
+    char badList[] = "3,9";
+    argv[4] = badList;
+    EXPECT_EQUAL(corpusAnalyzerMain(5, argv), 1);
+    char missing[] = "corpus-test-missing.csv";
+    argv[1] = missing;
+    EXPECT_EQUAL(corpusAnalyzerMain(3, argv), 1);
+    remove("corpus-test.csv");
+    remove("corpus-report.csv");
+}
+
+/* Analyzes a corpus and reports how many transitions per second it
+ * got through.
+ */
+static void analyzeWithReport(const string& corpus, int threads) {
+    istringstream in(corpus);
+    ostringstream report;
+    auto begin = chrono::steady_clock::now();
+    CorpusStats totals = analyzeCorpus(in, report, {0, 1, 2, 3, 4, 5}, threads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "    " << threads << " threads: " << totals.transitions << " transitions, "
+         << (long long)(totals.transitions / max(seconds, 1e-9)) << " per second" << endl;
+}
+
+/* The same corpus, one modulateBFS call per transition. */
+static void analyzeByQueries(const string& corpus) {
+    istringstream in(corpus);
+    string line;
+    long long transitions = 0;
+    long long distance = 0;
+    auto begin = chrono::steady_clock::now();
+    while (getline(in, line)) {
+        Vector<string> keys;
+        istringstream fields(line);
+        string field;
+        getline(fields, field, ',');
+        while (getline(fields, field, ',')) {
+            keys.add(field.substr(1));
+        }
+        for (int i = 1; i < keys.size(); i++) {
+            distance += modulateBFS(keys[i - 1], keys[i], {0, 1, 2, 3, 4, 5}).size() - 1;
+            transitions++;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "    modulateBFS per transition: " << transitions << " transitions, "
+         << (long long)(transitions / max(seconds, 1e-9)) << " per second" << endl;
+}
+
+STUDENT_TEST("Time trials on corpus analysis throughput") {
+    string corpus = generatedCorpus(500000, 2024);
+    TIME_OPERATION(corpus.size(), analyzeByQueries(generatedCorpus(20000, 2024)));
+    for (int threads : {1, 2, 4, 8}) {
+        TIME_OPERATION(corpus.size(), analyzeWithReport(corpus, threads));
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include "musicalkey.h"
+#include "set.h"
+
+/* Totals over a corpus, or over one piece. A transition is a pair of
+ * consecutive keys in a piece; its distance is the number of
+ * modulations on the shortest path between them, and each modulation
+ * on that path counts one use of its relation, numbered as in
+ * relatedKeys. Transitions with no path under the allowed relations
+ * are counted as unreachable and add nothing else.
+ */
+struct CorpusStats {
+    long long pieces = 0;
+    long long transitions = 0;
+    long long unreachable = 0;
+    long long totalDistance = 0;
+    long long relationUses[NUM_RELATIONS] = {};
+
+    void add(const CorpusStats& other);
+};
+
+/* Reads a corpus with one piece per line, its name followed by its keys
+ * in order, all separated by commas:
+ *
+ *     Symphony No. 5 i, C minor, Eb major, C minor
+ *
+ * Blank lines and lines starting with '#' are skipped. Writes one CSV
+ * line of statistics per piece to report, in corpus order, after a
+ * header line, and returns the totals. The corpus is read in blocks,
+ * and the pieces in each block are shared out among threads threads,
+ * which stay alive for the whole run, while the next block is read;
+ * threads <= 0 uses every hardware thread.
+ */
+CorpusStats analyzeCorpus(std::istream& corpus, std::ostream& report, const Set<int>& allowed, int threads = 0);
+CorpusStats analyzeCorpusFile(const std::string& corpusPath, const std::string& reportPath, const Set<int>& allowed,
+                              int threads = 0);
+
+/* The analyser as a pipeline stage, for a program's main to hand its
+ * arguments to:
+ *
+ *     analyze-corpus <corpus> <report> [--allowed 0,1,2,3,4,5] [--threads n]
+ *
+ * Prints the totals to cout and returns the exit status. The program
+ * itself is built from the AnalyzeCorpus directory.
+ */
+int corpusAnalyzerMain(int argc, char* argv[]);
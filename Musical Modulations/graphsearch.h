@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "vector.h"
+
+/* A fixed-size set of node numbers 0 .. size - 1, one bit per node. */
+class NodeSet {
+public:
+    explicit NodeSet(int size = 0) : words((size + 63) / 64, 0) {}
+
+    bool contains(int node) const {
+        return (words[node >> 6] >> (node & 63)) & 1;
+    }
+
+    void add(int node) {
+        words[node >> 6] |= uint64_t(1) << (node & 63);
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+/* Finds a shortest path from source to target in any directed graph of
+ * nodes numbered 0 .. graph.size() - 1. The graph supplies
+ *
+ *     int size() const;
+ *     void forEachSuccessor(int node, F visit) const;
+ *     void forEachPredecessor(int node, F visit) const;
+ *
+ * where the last two call visit(neighbor) for each edge out of or into
+ * node; an undirected graph gives the same neighbors to both.
+ *
+ * The search grows a layer at a time from both ends, always from the
+ * side with the smaller frontier, and stops after the first layer that
+ * touches the other side, keeping the meeting point that gives the
+ * shortest path. Each node is claimed by at most one side, so a single
+ * parent array serves both: a node reached from the source points back
+ * toward the source, and one reached from the target points on toward
+ * the target. The path is rebuilt once, at the end. Returns the nodes
+ * from source to target, or an empty Vector if there is no path; the
+ * number of nodes expanded is added to expanded.
+ */
+template <typename Graph>
+Vector<int> bidirectionalSearch(const Graph& graph, int source, int target, long long& expanded) {
+    if (source == target) {
+        return {source};
+    }
+    int n = graph.size();
+    std::vector<int> parent(n, -1);
+    NodeSet fromSource(n);
+    NodeSet fromTarget(n);
+    fromSource.add(source);
+    fromTarget.add(target);
+    std::vector<int> sourceFrontier = {source};
+    std::vector<int> targetFrontier = {target};
+    std::vector<int> nextFrontier;
+    int meetBefore = -1;
+    int meetAfter = -1;
+    int sourceDepth = 0;
+    int targetDepth = 0;
+    std::vector<int> depth(n, 0);
+
+    while (meetBefore < 0 && !sourceFrontier.empty() && !targetFrontier.empty()) {
+        bool forward = sourceFrontier.size() <= targetFrontier.size();
+        std::vector<int>& frontier = forward ? sourceFrontier : targetFrontier;
+        NodeSet& mine = forward ? fromSource : fromTarget;
+        const NodeSet& theirs = forward ? fromTarget : fromSource;
+        int best = -1;
+        nextFrontier.clear();
+        for (int node : frontier) {
+            expanded++;
+            auto visit = [&](int neighbor) {
+                if (theirs.contains(neighbor)) {
+                    /* The other side's depth is all that differs between
+                     * meeting points found in this layer
+                     */
+                    if (best < 0 || depth[neighbor] < best) {
+                        best = depth[neighbor];
+                        meetBefore = forward ? node : neighbor;
+                        meetAfter = forward ? neighbor : node;
+                    }
+                }
+                else if (!mine.contains(neighbor)) {
+                    mine.add(neighbor);
+                    parent[neighbor] = node;
+                    depth[neighbor] = (forward ? sourceDepth : targetDepth) + 1;
+                    nextFrontier.push_back(neighbor);
+                }
+            };
+            if (forward) {
+                graph.forEachSuccessor(node, visit);
+            }
+            else {
+                graph.forEachPredecessor(node, visit);
+            }
+        }
+        frontier.swap(nextFrontier);
+        (forward ? sourceDepth : targetDepth)++;
+    }
+    if (meetBefore < 0) {
+        return {};
+    }
+
+    Vector<int> path;
+    for (int at = meetBefore; at != -1; at = parent[at]) {
+        path.insert(0, at);
+    }
+    for (int at = meetAfter; at != -1; at = parent[at]) {
+        path.add(at);
+    }
+    return path;
+}
@@ -1,85 +1,20 @@
 #include "modulate.h"
 #include "testing/SimpleTest.h"
 #include "console.h"
+#include "error.h"
+#include <chrono>
 
 using namespace std;
 
-/* Global constants */
-const Vector<string> keys = {"A", "A#", "B", "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#"};
-const Map<string, string> enharmonics = {{"Bb","A#"}, {"Db","C#"}, {"Eb","D#"}, {"Gb","F#"}, {"Ab","G#"}};
-const Map<string, string> standard = {{"A# major", "Bb major"}, {"A# minor", "Bb minor"}, {"D# major", "Eb major"},
-                                      {"G# major", "Ab major"}, {"C# major", "Db major"}};
-
-/* This helper function converts a key to its traditional spelling. */
-string standardize(string key) {
-    if (standard.containsKey(key)) {
-        return standard.get(key);
-    }
-    return key;
-}
-
 /* This helper function generates the set of allowed related keys
  * to which a musical piece may modulate; i.e., the set of neighbors
- * in the decision tree.
+ * in the decision tree. The key is parsed once into its ID, and the
+ * neighbors are read off the precomputed adjacency masks.
  */
 Set<string> relatedKeys(string key, Set<int> allowed) {
     Set<string> related;
-
-    /* Extract tonality and modality from input */
-    string tonality = key.substr(0, 2);
-    string modality;
-    if (!isspace(tonality[1])) {
-        if (enharmonics.containsKey(tonality)) {
-            tonality = enharmonics.get(tonality);
-        }
-        modality = key.substr(3);
-    }
-    else {
-        tonality = tonality.substr(0, 1);
-        modality = key.substr(2);
-    }
-    int index = keys.indexOf(tonality);
-
-    /* Add allowed keys to set */
-    if (modality == "major") {
-        if (allowed.contains(0)) {
-            related.add(standardize(tonality + " minor"));
-        }
-        if (allowed.contains(1)) {
-            related.add(standardize(keys[(index + 2) % keys.size()] + " minor"));
-        }
-        if (allowed.contains(2)) {
-            related.add(standardize(keys[(index + 4) % keys.size()] + " minor"));
-        }
-        if (allowed.contains(3)) {
-            related.add(standardize(keys[(index + 5) % keys.size()] + " major"));
-        }
-        if (allowed.contains(4)) {
-            related.add(standardize(keys[(index + 7) % keys.size()] + " major"));
-        }
-        if (allowed.contains(5)) {
-            related.add(standardize(keys[(index + 9) % keys.size()] + " minor"));
-        }
-    }
-    else {
-        if (allowed.contains(0)) {
-            related.add(standardize(tonality + " major"));
-        }
-        if (allowed.contains(1)) {
-            related.add(standardize(keys[(index + keys.size() - 2) % keys.size()] + " major"));
-        }
-        if (allowed.contains(2)) {
-            related.add(standardize(keys[(index + keys.size() - 4) % keys.size()] + " major"));
-        }
-        if (allowed.contains(3)) {
-            related.add(standardize(keys[(index + keys.size() - 5) % keys.size()] +  " minor"));
-        }
-        if (allowed.contains(4)) {
-            related.add(standardize(keys[(index + keys.size() - 7) % keys.size()] + " minor"));
-        }
-        if (allowed.contains(5)) {
-            related.add(standardize(keys[(index + keys.size() - 9) % keys.size()] + " major"));
-        }
+    for (KeyMask next = relatedMask(keyId(key), allowedMask(allowed)); next != 0; next &= next - 1) {
+        related.add(keyName(__builtin_ctz(next)));
     }
     return related;
 }
@@ -97,110 +32,253 @@ bool containsMusicalKey(Stack<string> path, string key) {
     return false;
 }
 
-/** Solution 1: Breadth-First Search **/
-
- /* Stores paths in a Queue<Stack<string>>, adding a neighbor at each step
- * to expand outward by one level at a time. The Queue ensures that shorter
- * paths are explored before longer paths. As soon as the ending key is reached,
- * the current path is returned. If no path is found, an empty Stack is returned.
+/* Formats a path of IDs for output. The first and last keys keep the
+ * spellings the caller gave, and the keys in between use the standard
+ * spellings.
  */
-Stack<string> modulateBFS(string startKey, string endKey, Set<int> allowed) {
-    Stack<string> path = {startKey};
-    Queue<Stack<string>> paths;
-    paths.enqueue(path);
-
-    while (!paths.isEmpty()) {
-        path = paths.dequeue();
-        string enharmonicEndKey = enharmonics.get(endKey.substr(0, 2)) + endKey.substr(2);
-        /* Return path if endKey is reached */
-        if (path.peek() == endKey) {
-            return path;
-        }
-        else if (path.peek() == enharmonicEndKey) {
-            path.pop();
+Stack<string> formatPath(const Vector<KeyId>& ids, string startKey, string endKey) {
+    Stack<string> path;
+    for (int i = 0; i < ids.size(); i++) {
+        if (i == ids.size() - 1) {
             path.push(endKey);
-            return path;
+        }
+        else if (i == 0) {
+            path.push(startKey);
         }
         else {
-            /* Copy current path and append every neighbor */
-            Set<string> related = relatedKeys(path.peek(), allowed);
-            Set<string> valid;
-            for (string key : related) {
-                if (!containsMusicalKey(path, key)) {
-                    valid.add(key);
-                }
-            }
-            for (string key : valid) {
-                Stack<string> explore = path;
-                explore.push(key);
-                /* Enqueue longer paths */
-                paths.enqueue(explore);
+            path.push(keyName(ids[i]));
+        }
+    }
+    return path;
+}
+
+/** Solution 1: Breadth-First Search **/
+
+/* Searches over key IDs, with a 24-bit mask of the keys already seen.
+ * Each key is expanded at most once: its unseen neighbors are one AND
+ * away, and are enqueued lowest ID first, which is alphabetical order
+ * of their names. So every key is reached first along the shortest path
+ * that is smallest in that order, the same path the search over whole
+ * paths of strings returned. The number of keys expanded is added to
+ * expanded.
+ */
+Vector<KeyId> modulateBFSIds(KeyId start, KeyId end, int allowed, long long& expanded) {
+    KeyId parent[NUM_KEYS];
+    KeyId queue[NUM_KEYS];
+    int head = 0;
+    int tail = 0;
+    KeyMask seen = KeyMask(1) << start;
+    parent[start] = start;
+    queue[tail++] = start;
+    while (head < tail) {
+        KeyId key = queue[head++];
+        if (key == end) {
+            Vector<KeyId> path;
+            for (KeyId at = end; at != start; at = parent[at]) {
+                path.insert(0, at);
             }
+            path.insert(0, start);
+            return path;
+        }
+        expanded++;
+        KeyMask next = relatedMask(key, allowed) & ~seen;
+        seen |= next;
+        for (; next != 0; next &= next - 1) {
+            KeyId neighbor = __builtin_ctz(next);
+            parent[neighbor] = key;
+            queue[tail++] = neighbor;
         }
     }
     return {};
 }
 
+/* Returns the path as a Stack of key names, from startKey at the bottom
+ * to endKey at the top, or an empty Stack if there is no path. Keys are
+ * only turned back into strings once the path is found.
+ */
+Stack<string> modulateBFS(string startKey, string endKey, Set<int> allowed) {
+    long long expanded = 0;
+    Vector<KeyId> path = modulateBFSIds(keyId(startKey), keyId(endKey), allowedMask(allowed), expanded);
+    return formatPath(path, startKey, endKey);
+}
+
 /** Solution 2: Iterative Deepening Depth-First Search **/
 
 /* Uses recursive backtracking to explore as far as possible along
  * a single branch of the decision tree. When the maximum depth
  * allowed is reached, the function returns to previous levels
- * and considers other paths. Upon encountering the ending key, the
- * current path is saved in another variable, and "true" is returned.
+ * and considers other paths. The keys on the current path are kept
+ * both in order and as a mask, so checking whether a neighbor is
+ * already on the path is a single AND. Upon encountering the ending
+ * key, "true" is returned with the path left in place.
  */
-int modulateDFS(string startKey, string endKey, Set<int> allowed, Stack<string>& bestPath,
-                Stack<string>& currentPath, int maxDepth) {
+static bool modulateDFSIds(KeyId end, int allowed, Vector<KeyId>& path, KeyMask onPath, int maxDepth,
+                           long long& expanded) {
     /* If maximum depth is reached, return false */
     if (maxDepth < 0) {
         return false;
     }
-    string enharmonicEndKey = enharmonics.get(endKey.substr(0, 2)) + endKey.substr(2);
     /* If endKey is reached, return true */
-    if (currentPath.peek() == endKey || currentPath.peek() == enharmonicEndKey) {
-        bestPath = currentPath;
-        bestPath.pop();
-        bestPath.push(endKey);
+    if (path.back() == end) {
         return true;
     }
     /* Recursive case: loop through all neighbors, add each one to current
      * path, and explore
      */
-    Set<string> related = relatedKeys(currentPath.peek(), allowed);
-    Set<string> valid;
-    for (string key : related) {
-        if (!containsMusicalKey(currentPath, key)) {
-            valid.add(key);
-        }
-    }
-    for (string key : valid) {
-        currentPath.push(key);
-        if (modulateDFS(startKey, endKey, allowed, bestPath, currentPath, maxDepth - 1)) {
+    expanded++;
+    for (KeyMask next = relatedMask(path.back(), allowed) & ~onPath; next != 0; next &= next - 1) {
+        KeyId neighbor = __builtin_ctz(next);
+        path.add(neighbor);
+        if (modulateDFSIds(end, allowed, path, onPath | KeyMask(1) << neighbor, maxDepth - 1, expanded)) {
             return true;
         }
-        currentPath.pop();
+        path.removeBack();
     }
     return false;
 }
 
+Vector<KeyId> modulateDFSIds(KeyId start, KeyId end, int allowed, long long& expanded) {
+    Vector<KeyId> path = {start};
+    /* Iteratively deepen the search */
+    for (int i = 0; i < NUM_KEYS; i++) {
+        if (modulateDFSIds(end, allowed, path, KeyMask(1) << start, i, expanded)) {
+            return path;
+        }
+    }
+    return {};
+}
+
 /* Main wrapper function that gradually expands the allowed depth of
- * the search from 0 to 24. We can be confident that any path will
- * be of length between these two values, so the iterative deepening
- * works well.
+ * the search from 0 to 23. No simple path visits more than the 24
+ * keys, so any path will be found within these depths, and the
+ * iterative deepening works well.
  */
 Stack<string> modulateDFS(string startKey, string endKey, Set<int> allowed) {
-    Stack<string> currPath;
-    Stack<string> best;
-    currPath.push(startKey);
-    /* Iteratively deepen the search */
-    for (int i = 0; i <= 24; i++) {
-        if (modulateDFS(startKey, endKey, allowed, best, currPath, i)) {
-            return best;
+    long long expanded = 0;
+    Vector<KeyId> path = modulateDFSIds(keyId(startKey), keyId(endKey), allowedMask(allowed), expanded);
+    return formatPath(path, startKey, endKey);
+}
+
+/** Solution 3: A* Search
+ * Each relation has its own cost, and the path returned is the one
+ * whose costs add up to the least.
+ * Time Complexity: O(E log E) over the 24 keys and their at most 144
+ * edges, with far fewer keys expanded than BFS when the heuristic is
+ * tight.
+ **/
+
+/* How far each relation moves a key around the circle of fifths: the
+ * parallel key is three fifths away, the relative key shares its
+ * signature, and the other four are one fifth away. The distance is the
+ * same from every key, so it is read off from key 0.
+ */
+static int fifthsMoved(int relation) {
+    return fifthsDistance(0, relatedKey(0, relation));
+}
+
+/* Searches over key IDs, expanding keys in order of the cost so far
+ * plus an estimate of the cost still to go. The estimate is the number
+ * of fifths between the key and the end, times the lowest cost per
+ * fifth of any allowed relation. No relation covers more fifths per
+ * unit of cost than that, so the estimate never overestimates, and it
+ * changes along an edge by no more than the edge's cost, so a key is
+ * final the first time it is expanded. Relations whose cost is infinite
+ * are not allowed. With useHeuristic false the estimate is zero and
+ * this is Dijkstra's algorithm. The path's cost is stored in totalCost
+ * and the number of keys expanded is added to expanded.
+ */
+Vector<KeyId> modulateWeightedIds(KeyId start, KeyId end, const Vector<double>& costs, bool useHeuristic,
+                                  double& totalCost, long long& expanded) {
+    double perFifth = 0;
+    if (useHeuristic) {
+        perFifth = INFINITY;
+        for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+            if (fifthsMoved(relation) > 0 && costs[relation] != INFINITY) {
+                perFifth = min(perFifth, costs[relation] / fifthsMoved(relation));
+            }
+        }
+        if (perFifth == INFINITY) {
+            perFifth = 0;
         }
     }
+    double best[NUM_KEYS];
+    KeyId parent[NUM_KEYS];
+    fill(best, best + NUM_KEYS, INFINITY);
+    KeyMask closed = 0;
+    PriorityQueue<KeyId> frontier;
+    best[start] = 0;
+    parent[start] = start;
+    frontier.enqueue(start, perFifth * fifthsDistance(start, end));
+    while (!frontier.isEmpty()) {
+        KeyId key = frontier.dequeue();
+        /* Skip stale entries left behind when a key's cost was lowered */
+        if (closed & KeyMask(1) << key) {
+            continue;
+        }
+        if (key == end) {
+            Vector<KeyId> path;
+            for (KeyId at = end; at != start; at = parent[at]) {
+                path.insert(0, at);
+            }
+            path.insert(0, start);
+            totalCost = best[end];
+            return path;
+        }
+        closed |= KeyMask(1) << key;
+        expanded++;
+        for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+            KeyId neighbor = relatedKey(key, relation);
+            double cost = best[key] + costs[relation];
+            if (costs[relation] == INFINITY || (closed & KeyMask(1) << neighbor) || cost >= best[neighbor]) {
+                continue;
+            }
+            best[neighbor] = cost;
+            parent[neighbor] = key;
+            frontier.enqueue(neighbor, cost + perFifth * fifthsDistance(neighbor, end));
+        }
+    }
+    totalCost = INFINITY;
     return {};
 }
 
+/* Wrapper function for A*. costs maps each allowed relation, numbered
+ * as in relatedKeys, to the non-negative cost of taking it; relations
+ * missing from the map are not allowed. Returns the cheapest path as a
+ * Stack of key names, or an empty Stack if there is no path.
+ */
+Stack<string> modulateWeighted(string startKey, string endKey, Map<int, double> costs) {
+    Vector<double> relationCosts(NUM_RELATIONS, INFINITY);
+    for (int relation : costs) {
+        if (relation < 0 || relation >= NUM_RELATIONS) {
+            error("modulateWeighted: there is no relation " + to_string(relation));
+        }
+        if (!(costs[relation] >= 0)) {
+            error("modulateWeighted: the cost of relation " + to_string(relation) + " must be non-negative");
+        }
+        relationCosts[relation] = costs[relation];
+    }
+    double totalCost = 0;
+    long long expanded = 0;
+    Vector<KeyId> path = modulateWeightedIds(keyId(startKey), keyId(endKey), relationCosts, true, totalCost,
+                                             expanded);
+    return formatPath(path, startKey, endKey);
+}
+
+/** Solution 4: Bidirectional Breadth-First Search
+ * Time Complexity: O(b^(d/2)) keys expanded for branching factor b and
+ * path length d, against O(b^d) for a search from one end.
+ **/
+
+/* Wrapper function for the generic bidirectional search over the key
+ * graph. The path is as short as modulateBFS's, but where several
+ * shortest paths exist it may pass through different keys.
+ */
+Stack<string> modulateBidirectional(string startKey, string endKey, Set<int> allowed) {
+    long long expanded = 0;
+    Vector<KeyId> path = bidirectionalSearch(KeyGraph{allowedMask(allowed)}, keyId(startKey), keyId(endKey), expanded);
+    return formatPath(path, startKey, endKey);
+}
+
 
 /* * * * * * * * * * Test cases below this point * * * * * * * * * */
 
@@ -255,3 +333,327 @@ STUDENT_TEST("Test modulate") {
     /* No path from start to end */
     EXPECT_EQUAL(modulateDFS("G minor", "Ab major",{1}).size(), 0);
 }
+
+/* The original search over strings, kept as the baseline for the time
+ * trials: it parses each key and builds a Set<string> of neighbors on
+ * every expansion, and queues whole paths.
+ */
+const Vector<string> keys = {"A", "A#", "B", "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#"};
+const Map<string, string> enharmonics = {{"Bb","A#"}, {"Db","C#"}, {"Eb","D#"}, {"Gb","F#"}, {"Ab","G#"}};
+const Map<string, string> standard = {{"A# major", "Bb major"}, {"A# minor", "Bb minor"}, {"D# major", "Eb major"},
+                                      {"G# major", "Ab major"}, {"C# major", "Db major"}};
+
+static string standardize(string key) {
+    if (standard.containsKey(key)) {
+        return standard.get(key);
+    }
+    return key;
+}
+
+static Set<string> relatedKeysByName(string key, Set<int> allowed) {
+    Set<string> related;
+    string tonality = key.substr(0, 2);
+    string modality;
+    if (!isspace(tonality[1])) {
+        if (enharmonics.containsKey(tonality)) {
+            tonality = enharmonics.get(tonality);
+        }
+        modality = key.substr(3);
+    }
+    else {
+        tonality = tonality.substr(0, 1);
+        modality = key.substr(2);
+    }
+    int index = keys.indexOf(tonality);
+    const int majorSteps[] = {0, 2, 4, 5, 7, 9};
+    const bool majorToMinor[] = {true, true, true, false, false, true};
+    for (int relation = 0; relation < 6; relation++) {
+        if (!allowed.contains(relation)) {
+            continue;
+        }
+        if (modality == "major") {
+            related.add(standardize(keys[(index + majorSteps[relation]) % keys.size()] +
+                                    (majorToMinor[relation] ? " minor" : " major")));
+        }
+        else {
+            related.add(standardize(keys[(index + keys.size() - majorSteps[relation]) % keys.size()] +
+                                    (majorToMinor[relation] ? " major" : " minor")));
+        }
+    }
+    return related;
+}
+
+static Stack<string> modulateBFSByName(string startKey, string endKey, Set<int> allowed, long long& expanded) {
+    Stack<string> path = {startKey};
+    Queue<Stack<string>> paths;
+    paths.enqueue(path);
+    while (!paths.isEmpty()) {
+        path = paths.dequeue();
+        string enharmonicEndKey = enharmonics.get(endKey.substr(0, 2)) + endKey.substr(2);
+        if (path.peek() == endKey) {
+            return path;
+        }
+        else if (path.peek() == enharmonicEndKey) {
+            path.pop();
+            path.push(endKey);
+            return path;
+        }
+        expanded++;
+        for (string key : relatedKeysByName(path.peek(), allowed)) {
+            if (!containsMusicalKey(path, key)) {
+                Stack<string> explore = path;
+                explore.push(key);
+                paths.enqueue(explore);
+            }
+        }
+    }
+    return {};
+}
+
+STUDENT_TEST("Key IDs round-trip through every spelling") {
+    for (KeyId id = 0; id < NUM_KEYS; id++) {
+        EXPECT_EQUAL(keyId(keyName(id)), id);
+        if (id > 0) {
+            EXPECT(keyName(id - 1) < keyName(id));
+        }
+    }
+    EXPECT_EQUAL(keyId("A# minor"), keyId("Bb minor"));
+    EXPECT_EQUAL(keyId("Gb major"), keyId("F# major"));
+    EXPECT_EQUAL(keyId("C# major"), keyId("Db major"));
+    EXPECT_ERROR(keyId("H major"));
+    EXPECT_ERROR(keyId("C dorian"));
+    EXPECT_ERROR(keyId("C"));
+    EXPECT_EQUAL(allowedMask({0, 3, 5}), 0x29);
+
+    for (int allowed = 0; allowed < NUM_ALLOWED_SETS; allowed++) {
+        Set<int> relations;
+        for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+            if (allowed & (1 << relation)) {
+                relations.add(relation);
+            }
+        }
+        for (KeyId id = 0; id < NUM_KEYS; id++) {
+            EXPECT_EQUAL(relatedKeys(keyName(id), relations), relatedKeysByName(keyName(id), relations));
+        }
+    }
+}
+
+STUDENT_TEST("Searches over key IDs return the same paths as the search over strings") {
+    Vector<Set<int>> allowedSets = {{0, 1, 2, 3, 4, 5}, {3, 4}, {0, 3}, {1, 5}, {2}, {0, 2, 4}};
+    for (const Set<int>& allowed : allowedSets) {
+        for (KeyId start = 0; start < NUM_KEYS; start++) {
+            for (KeyId end = 0; end < NUM_KEYS; end++) {
+                long long expanded = 0;
+                Stack<string> expected = modulateBFSByName(keyName(start), keyName(end), allowed, expanded);
+                EXPECT_EQUAL(modulateBFS(keyName(start), keyName(end), allowed), expected);
+                EXPECT_EQUAL(modulateDFS(keyName(start), keyName(end), allowed), expected);
+            }
+        }
+    }
+    // Sharp spellings of keys usually written with flats are now found too
+    EXPECT_EQUAL(modulateBFS("C major", "C# major", {0, 1, 2, 3, 4, 5}).peek(), "C# major");
+}
+
+/* Runs a search from every key to every other key and reports how many
+ * keys it expanded per second.
+ */
+static long long expandAllPairs(bool byName, Set<int> allowed) {
+    long long expanded = 0;
+    auto begin = chrono::steady_clock::now();
+    for (KeyId start = 0; start < NUM_KEYS; start++) {
+        for (KeyId end = 0; end < NUM_KEYS; end++) {
+            if (byName) {
+                modulateBFSByName(keyName(start), keyName(end), allowed, expanded);
+            }
+            else {
+                modulateBFSIds(start, end, allowedMask(allowed), expanded);
+            }
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "    " << (byName ? "strings: " : "key IDs: ") << expanded << " keys expanded, "
+         << (long long)(expanded / max(seconds, 1e-9)) << " per second" << endl;
+    return expanded;
+}
+
+STUDENT_TEST("Time trials on keys expanded per second over strings and key IDs") {
+    Vector<Set<int>> allowedSets = {{0, 1, 2, 3, 4, 5}, {3, 4}, {0, 2, 4}};
+    for (const Set<int>& allowed : allowedSets) {
+        TIME_OPERATION(allowed.size(), expandAllPairs(true, allowed));
+        TIME_OPERATION(allowed.size(), expandAllPairs(false, allowed));
+    }
+}
+
+STUDENT_TEST("modulateWeighted finds the cheapest path") {
+    /* With every relation costing the same, the cheapest paths are the
+     * shortest ones
+     */
+    Map<int, double> unit = {{0, 1}, {1, 1}, {2, 1}, {3, 1}, {4, 1}, {5, 1}};
+    for (KeyId start = 0; start < NUM_KEYS; start++) {
+        for (KeyId end = 0; end < NUM_KEYS; end++) {
+            Stack<string> path = modulateWeighted(keyName(start), keyName(end), unit);
+            EXPECT_EQUAL(path.size(), modulateBFS(keyName(start), keyName(end), {0, 1, 2, 3, 4, 5}).size());
+            EXPECT_EQUAL(path.peek(), keyName(end));
+        }
+    }
+
+    /* An expensive dominant is avoided in favor of two cheap steps
+     * through the mediant and its relative key
+     */
+    Stack<string> result = modulateWeighted("C major", "G major", {{4, 10}, {2, 1}, {5, 1}});
+    EXPECT_EQUAL(result.size(), 3);
+    EXPECT_EQUAL(result.pop(), "G major");
+    EXPECT_EQUAL(result.pop(), "E minor");
+
+    /* Relations missing from the table are not allowed */
+    EXPECT_EQUAL(modulateWeighted("G minor", "Ab major", {{1, 1}}).size(), 0);
+    EXPECT_EQUAL(modulateWeighted("Db major", "A minor", {{3, 2}, {5, 0}}).size(), 7);
+
+    EXPECT_ERROR(modulateWeighted("C major", "G major", {{4, -1}}));
+    EXPECT_ERROR(modulateWeighted("C major", "G major", {{6, 1}}));
+}
+
+STUDENT_TEST("A* costs match Dijkstra's on random cost tables") {
+    for (int trial = 0; trial < 200; trial++) {
+        Vector<double> costs(NUM_RELATIONS, INFINITY);
+        for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+            if (randomChance(0.8)) {
+                costs[relation] = randomInteger(0, 20) / 4.0;
+            }
+        }
+        for (KeyId start = 0; start < NUM_KEYS; start++) {
+            for (KeyId end = 0; end < NUM_KEYS; end++) {
+                double aStarCost = 0;
+                double dijkstraCost = 0;
+                long long expanded = 0;
+                Vector<KeyId> path = modulateWeightedIds(start, end, costs, true, aStarCost, expanded);
+                modulateWeightedIds(start, end, costs, false, dijkstraCost, expanded);
+                EXPECT_EQUAL(aStarCost, dijkstraCost);
+                /* The path returned costs what was reported */
+                double pathCost = path.isEmpty() ? INFINITY : 0;
+                for (int i = 1; i < path.size(); i++) {
+                    for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+                        if (relatedKey(path[i - 1], relation) == path[i]) {
+                            pathCost += costs[relation];
+                        }
+                    }
+                }
+                EXPECT_EQUAL(pathCost, aStarCost);
+            }
+        }
+    }
+}
+
+/* Runs a search from every key to every other key and reports how many
+ * keys it expanded in total.
+ */
+static long long expandWeightedPairs(const Vector<double>& costs, bool useHeuristic) {
+    long long expanded = 0;
+    for (KeyId start = 0; start < NUM_KEYS; start++) {
+        for (KeyId end = 0; end < NUM_KEYS; end++) {
+            double totalCost = 0;
+            modulateWeightedIds(start, end, costs, useHeuristic, totalCost, expanded);
+        }
+    }
+    cout << "    " << (useHeuristic ? "A*: " : "Dijkstra: ") << expanded << " keys expanded" << endl;
+    return expanded;
+}
+
+STUDENT_TEST("Time trials on keys expanded by A*, Dijkstra's algorithm and BFS") {
+    Vector<Vector<double>> costTables = {{1, 1, 1, 1, 1, 1}, {3, 2, 2, 1, 1, 1}, {5, 4, 4, 1, 1, 2}};
+    for (const Vector<double>& costs : costTables) {
+        long long aStar = 0;
+        long long dijkstra = 0;
+        TIME_OPERATION(NUM_KEYS * NUM_KEYS, aStar = expandWeightedPairs(costs, true));
+        TIME_OPERATION(NUM_KEYS * NUM_KEYS, dijkstra = expandWeightedPairs(costs, false));
+        EXPECT(aStar <= dijkstra);
+    }
+    TIME_OPERATION(NUM_KEYS * NUM_KEYS, expandAllPairs(false, {0, 1, 2, 3, 4, 5}));
+}
+
+STUDENT_TEST("Bidirectional search finds shortest paths in both directions") {
+    for (int allowed = 0; allowed < NUM_ALLOWED_SETS; allowed++) {
+        KeyGraph graph = {allowed};
+        for (KeyId key = 0; key < NUM_KEYS; key++) {
+            KeyMask successors = 0;
+            KeyMask predecessors = 0;
+            graph.forEachSuccessor(key, [&](int next) { successors |= KeyMask(1) << next; });
+            graph.forEachPredecessor(key, [&](int previous) { predecessors |= KeyMask(1) << previous; });
+            for (KeyId other = 0; other < NUM_KEYS; other++) {
+                EXPECT_EQUAL(bool(predecessors & KeyMask(1) << other), bool(relatedMask(other, allowed) & KeyMask(1) << key));
+            }
+        }
+        for (KeyId start = 0; start < NUM_KEYS; start++) {
+            for (KeyId end = 0; end < NUM_KEYS; end++) {
+                long long expanded = 0;
+                Vector<KeyId> expected = modulateBFSIds(start, end, allowed, expanded);
+                Vector<KeyId> path = bidirectionalSearch(graph, start, end, expanded);
+                EXPECT_EQUAL(path.size(), expected.size());
+                if (!path.isEmpty()) {
+                    EXPECT_EQUAL(path[0], start);
+                    EXPECT_EQUAL(path.back(), end);
+                }
+                for (int i = 1; i < path.size(); i++) {
+                    EXPECT(relatedMask(path[i - 1], allowed) & KeyMask(1) << path[i]);
+                }
+            }
+        }
+    }
+    EXPECT_EQUAL(modulateBidirectional("C major", "Bb minor", {0,1,2,3,4,5}).size(), 4);
+    EXPECT_EQUAL(modulateBidirectional("Db major", "A minor", {3,5}).size(), 7);
+    EXPECT_EQUAL(modulateBidirectional("G minor", "Ab major", {1}).size(), 0);
+}
+
+/* A ring of n nodes where node i leads only to node i + 1. */
+struct RingGraph {
+    int n;
+
+    int size() const {
+        return n;
+    }
+
+    template <typename F>
+    void forEachSuccessor(int node, F visit) const {
+        visit((node + 1) % n);
+    }
+
+    template <typename F>
+    void forEachPredecessor(int node, F visit) const {
+        visit((node + n - 1) % n);
+    }
+};
+
+STUDENT_TEST("Bidirectional search works on any graph and expands half as many nodes on a long ring") {
+    RingGraph ring = {1000};
+    long long expanded = 0;
+    Vector<int> path = bidirectionalSearch(ring, 10, 5, expanded);
+    EXPECT_EQUAL(path.size(), 996);
+    EXPECT_EQUAL(path[0], 10);
+    EXPECT_EQUAL(path[990], 0);
+    EXPECT_EQUAL(path.back(), 5);
+    EXPECT(expanded <= 996);
+    EXPECT_EQUAL(bidirectionalSearch(ring, 7, 7, expanded).size(), 1);
+}
+
+STUDENT_TEST("Time trials on keys expanded by one-way and bidirectional search") {
+    Vector<Set<int>> allowedSets = {{0, 1, 2, 3, 4, 5}, {3, 4}, {3, 5}, {0, 2, 4}};
+    for (const Set<int>& allowed : allowedSets) {
+        long long oneWay = 0;
+        long long bothWays = 0;
+        auto searchAllPairs = [&](bool bidirectional) {
+            for (KeyId start = 0; start < NUM_KEYS; start++) {
+                for (KeyId end = 0; end < NUM_KEYS; end++) {
+                    if (bidirectional) {
+                        bidirectionalSearch(KeyGraph{allowedMask(allowed)}, start, end, bothWays);
+                    }
+                    else {
+                        modulateBFSIds(start, end, allowedMask(allowed), oneWay);
+                    }
+                }
+            }
+        };
+        TIME_OPERATION(allowed.size(), searchAllPairs(false));
+        TIME_OPERATION(allowed.size(), searchAllPairs(true));
+        cout << "    " << allowed << ": one-way " << oneWay << ", bidirectional " << bothWays << " keys expanded" << endl;
+    }
+}
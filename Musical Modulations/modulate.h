@@ -10,12 +10,49 @@
 #include "set.h"
 #include "stack.h"
 #include "priorityqueue.h"
+#include "musicalkey.h"
+#include "graphsearch.h"
 
 Set<std::string> relatedKeys(std::string key, Set<int> allowed);
 
 bool containsMusicalKey(Stack<std::string> path, std::string key);
 
+Stack<std::string> formatPath(const Vector<KeyId>& ids, std::string startKey, std::string endKey);
+
 Stack<std::string> modulateBFS(std::string startKey, std::string endKey, Set<int> allowed);
+Vector<KeyId> modulateBFSIds(KeyId start, KeyId end, int allowed, long long& expanded);
 
 Stack<std::string> modulateDFS(std::string startKey, std::string endKey, Set<int> allowed);
+Vector<KeyId> modulateDFSIds(KeyId start, KeyId end, int allowed, long long& expanded);
+
+
+Stack<std::string> modulateWeighted(std::string startKey, std::string endKey, Map<int, double> costs);
+Vector<KeyId> modulateWeightedIds(KeyId start, KeyId end, const Vector<double>& costs, bool useHeuristic,
+                                  double& totalCost, long long& expanded);
+
+/* The modulation graph for one allowed set, in the form
+ * bidirectionalSearch expects.
+ */
+struct KeyGraph {
+    int allowed;
+
+    int size() const {
+        return NUM_KEYS;
+    }
+
+    template <typename F>
+    void forEachSuccessor(int key, F visit) const {
+        for (KeyMask next = relatedMask(key, allowed); next != 0; next &= next - 1) {
+            visit(__builtin_ctz(next));
+        }
+    }
+
+    template <typename F>
+    void forEachPredecessor(int key, F visit) const {
+        for (KeyMask next = relatedMask(key, reversedRelations(allowed)); next != 0; next &= next - 1) {
+            visit(__builtin_ctz(next));
+        }
+    }
+};
 
+Stack<std::string> modulateBidirectional(std::string startKey, std::string endKey, Set<int> allowed);
@@ -0,0 +1,228 @@
+#include "modulationcache.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "modulate.h"
+#include "testinputs.h"
+#include "testing/SimpleTest.h"
+
+using namespace std;
+
+/* Fills the table for one allowed set with a breadth-first search from
+ * every key. Neighbors are visited lowest ID first, as in modulateBFS,
+ * so each search tree holds the same paths modulateBFS returns, and
+ * the first hop toward each key is inherited down the tree. Walking
+ * the table reproduces those paths: the tail of the alphabetically
+ * first shortest path is itself the alphabetically first shortest path
+ * from its second key, or a smaller one would give a smaller whole.
+ */
+void ModulationCache::fill(int allowed) {
+    for (KeyId start = 0; start < NUM_KEYS; start++) {
+        int8_t* hops = nextHop[allowed][start];
+        for (KeyId end = 0; end < NUM_KEYS; end++) {
+            hops[end] = -1;
+        }
+        hops[start] = int8_t(start);
+        KeyId queue[NUM_KEYS];
+        int head = 0;
+        int tail = 0;
+        KeyMask seen = KeyMask(1) << start;
+        queue[tail++] = start;
+        while (head < tail) {
+            KeyId key = queue[head++];
+            KeyMask next = relatedMask(key, allowed) & ~seen;
+            seen |= next;
+            for (; next != 0; next &= next - 1) {
+                KeyId neighbor = __builtin_ctz(next);
+                hops[neighbor] = int8_t(key == start ? neighbor : hops[key]);
+                queue[tail++] = neighbor;
+            }
+        }
+    }
+}
+
+/* Fills every table now, so later queries never wait on a search. */
+void ModulationCache::precomputeAll() {
+    for (int allowed = 0; allowed < NUM_ALLOWED_SETS; allowed++) {
+        call_once(filled[allowed], [this, allowed] { fill(allowed); });
+    }
+}
+
+/* The path from start to end as IDs, or an empty Vector if there is
+ * none. call_once makes the first query for an allowed set fill its
+ * table exactly once, however many threads ask at the same time, and
+ * makes the filled table visible to all of them.
+ */
+Vector<KeyId> ModulationCache::path(KeyId start, KeyId end, int allowed) {
+    call_once(filled[allowed], [this, allowed] { fill(allowed); });
+    const int8_t (*hops)[NUM_KEYS] = nextHop[allowed];
+    if (hops[start][end] < 0) {
+        return {};
+    }
+    Vector<KeyId> path = {start};
+    for (KeyId at = start; at != end;) {
+        at = hops[at][end];
+        path.add(at);
+    }
+    return path;
+}
+
+/* Formats the path straight from the table, without building the path
+ * of IDs first.
+ */
+Stack<string> ModulationCache::modulate(const string& startKey, const string& endKey, const Set<int>& allowed) {
+    KeyId start = keyId(startKey);
+    KeyId end = keyId(endKey);
+    int mask = allowedMask(allowed);
+    call_once(filled[mask], [this, mask] { fill(mask); });
+    Stack<string> path;
+    if (nextHop[mask][start][end] < 0) {
+        return path;
+    }
+    for (KeyId at = start; at != end; at = nextHop[mask][at][end]) {
+        path.push(at == start ? startKey : keyName(at));
+    }
+    path.push(endKey);
+    return path;
+}
+
+Vector<Stack<string>> ModulationCache::modulateBatch(const Vector<ModulationQuery>& queries) {
+    Vector<Stack<string>> paths;
+    for (const ModulationQuery& query : queries) {
+        paths.add(modulate(query.startKey, query.endKey, query.allowed));
+    }
+    return paths;
+}
+
+/* Process-wide cache used by the free functions below. */
+ModulationCache& ModulationCache::shared() {
+    static ModulationCache cache;
+    return cache;
+}
+
+/* Same interface and results as modulateBFS, answered from the shared
+ * cache.
+ */
+Stack<string> modulateCached(string startKey, string endKey, Set<int> allowed) {
+    return ModulationCache::shared().modulate(startKey, endKey, allowed);
+}
+
+Vector<Stack<string>> modulateBatch(const Vector<ModulationQuery>& queries) {
+    return ModulationCache::shared().modulateBatch(queries);
+}
+
+/* * * * * * * * * * Test cases below this point * * * * * * * * * */
+
+/* Every spelling the key parser accepts, to check that the cached
+ * queries keep the caller's spelling of the start and end keys.
+ */
+static Vector<string> allSpellings() {
+    Vector<string> spellings;
+    for (KeyId id = 0; id < NUM_KEYS; id++) {
+        spellings.add(keyName(id));
+    }
+    Vector<string> extra = {"A# major", "A# minor", "C# major", "D# major", "G# major", "Db minor", "Eb minor",
+                            "Gb major", "Gb minor", "Ab minor"};
+    for (const string& key : extra) {
+        spellings.add(key);
+    }
+    return spellings;
+}
+
+STUDENT_TEST("Cached paths match modulateBFS for every allowed set and spelling") {
+    Vector<string> spellings = allSpellings();
+    ModulationCache cache;
+    for (int allowed = 0; allowed < NUM_ALLOWED_SETS; allowed++) {
+        Set<int> relations = relationsOf(allowed);
+        for (const string& start : spellings) {
+            for (const string& end : spellings) {
+                EXPECT_EQUAL(cache.modulate(start, end, relations), modulateBFS(start, end, relations));
+            }
+        }
+    }
+    EXPECT_EQUAL(modulateCached("C major", "Bb minor", {0, 1, 2, 3, 4, 5}).size(), 4);
+    EXPECT_EQUAL(modulateCached("C major", "Bb minor", {0, 1, 2, 3, 4, 5}).peek(), "Bb minor");
+    EXPECT_EQUAL(modulateCached("G minor", "Ab major", {1}).size(), 0);
+    EXPECT_ERROR(modulateCached("C major", "C lydian", {1}));
+
+    Vector<ModulationQuery> queries = {{"Db major", "A minor", {3, 5}}, {"C major", "C major", {}},
+                                       {"G minor", "Ab major", {1}}};
+    Vector<Stack<string>> paths = modulateBatch(queries);
+    EXPECT_EQUAL(paths.size(), 3);
+    for (int i = 0; i < queries.size(); i++) {
+        EXPECT_EQUAL(paths[i], modulateBFS(queries[i].startKey, queries[i].endKey, queries[i].allowed));
+    }
+}
+
+STUDENT_TEST("Cache fills each table once when many threads query it at the same time") {
+    ModulationCache cache;
+    atomic<int> mismatches(0);
+    vector<thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&cache, &mismatches, t] {
+            for (int allowed = 0; allowed < NUM_ALLOWED_SETS; allowed++) {
+                for (KeyId start = 0; start < NUM_KEYS; start++) {
+                    KeyId end = (start * 7 + t + allowed) % NUM_KEYS;
+                    long long expanded = 0;
+                    if (cache.path(start, end, allowed) != modulateBFSIds(start, end, allowed, expanded)) {
+                        mismatches++;
+                    }
+                }
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    EXPECT_EQUAL(mismatches.load(), 0);
+}
+
+/* Answers the same million-query batch from the cache or by searching. */
+static int answerQueries(const Vector<ModulationQuery>& queries, bool cached) {
+    int found = 0;
+    if (cached) {
+        for (const Stack<string>& path : modulateBatch(queries)) {
+            found += !path.isEmpty();
+        }
+    }
+    else {
+        for (const ModulationQuery& query : queries) {
+            found += !modulateBFS(query.startKey, query.endKey, query.allowed).isEmpty();
+        }
+    }
+    return found;
+}
+
+/* The same queries over IDs, without any parsing or formatting. */
+static int answerQueryIds(int n, bool cached) {
+    ModulationCache& cache = ModulationCache::shared();
+    int length = 0;
+    long long expanded = 0;
+    for (int i = 0; i < n; i++) {
+        KeyId start = i % NUM_KEYS;
+        KeyId end = (i * 13 + 5) % NUM_KEYS;
+        int allowed = i % NUM_ALLOWED_SETS;
+        length += cached ? cache.path(start, end, allowed).size() : modulateBFSIds(start, end, allowed, expanded).size();
+    }
+    return length;
+}
+
+STUDENT_TEST("Time trials on cached and batched modulation queries") {
+    auto begin = chrono::steady_clock::now();
+    ModulationCache::shared().precomputeAll();
+    cout << "    precomputing all 64 tables took "
+         << chrono::duration<double>(chrono::steady_clock::now() - begin).count() << " secs" << endl;
+    Vector<string> spellings = allSpellings();
+    for (int n = 10000; n <= 1000000; n *= 10) {
+        Vector<ModulationQuery> queries;
+        for (int i = 0; i < n; i++) {
+            queries.add({spellings[i % spellings.size()], spellings[(i * 13 + 5) % spellings.size()],
+                         relationsOf(i % NUM_ALLOWED_SETS)});
+        }
+        TIME_OPERATION(n, answerQueries(queries, false));
+        TIME_OPERATION(n, answerQueries(queries, true));
+        TIME_OPERATION(n, answerQueryIds(n, false));
+        TIME_OPERATION(n, answerQueryIds(n, true));
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include "musicalkey.h"
+#include "set.h"
+#include "stack.h"
+#include "vector.h"
+
+/* One modulation query, as passed to modulateBFS. */
+struct ModulationQuery {
+    std::string startKey;
+    std::string endKey;
+    Set<int> allowed;
+};
+
+/* All-pairs next-hop tables for the modulation graph, one per allowed
+ * set. A table is filled on first use by any thread, after which a path
+ * query walks it one hop at a time, in time proportional to the path's
+ * length. Results are exactly those of modulateBFS.
+ */
+class ModulationCache {
+public:
+    ModulationCache() = default;
+    ModulationCache(const ModulationCache&) = delete;
+    ModulationCache& operator=(const ModulationCache&) = delete;
+
+    void precomputeAll();
+    Vector<KeyId> path(KeyId start, KeyId end, int allowed);
+    Stack<std::string> modulate(const std::string& startKey, const std::string& endKey, const Set<int>& allowed);
+    Vector<Stack<std::string>> modulateBatch(const Vector<ModulationQuery>& queries);
+
+    static ModulationCache& shared();
+
+private:
+    void fill(int allowed);
+
+    std::once_flag filled[NUM_ALLOWED_SETS];
+    int8_t nextHop[NUM_ALLOWED_SETS][NUM_KEYS][NUM_KEYS];
+};
+
+Stack<std::string> modulateCached(std::string startKey, std::string endKey, Set<int> allowed);
+Vector<Stack<std::string>> modulateBatch(const Vector<ModulationQuery>& queries);
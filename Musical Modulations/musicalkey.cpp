@@ -0,0 +1,88 @@
+#include "musicalkey.h"
+#include <cstring>
+#include "error.h"
+
+using namespace std;
+
+/* Standard spellings, indexed by ID. */
+static const string KEY_NAMES[NUM_KEYS] = {
+    "A major", "A minor", "Ab major", "B major", "B minor", "Bb major", "Bb minor", "C major",
+    "C minor", "C# minor", "D major", "D minor", "D# minor", "Db major", "E major", "E minor",
+    "Eb major", "F major", "F minor", "F# major", "F# minor", "G major", "G minor", "G# minor"};
+
+/* Parses the tonic at the start of a key name into its pitch class,
+ * leaving at just past it, or returns -1. The natural letters and their
+ * sharps and flats are accepted, except for the spellings (Cb, Fb, E#,
+ * B#) that name a natural note.
+ */
+int tonicPitch(const char* key, size_t length, size_t& at) {
+    static const int LETTER_PITCH[7] = {0, 2, 3, 5, 7, 8, 10};
+    at = 0;
+    if (length == 0 || key[0] < 'A' || key[0] > 'G') {
+        return -1;
+    }
+    char letter = key[at++];
+    int pitch = LETTER_PITCH[letter - 'A'];
+    if (at < length && key[at] == '#' && letter != 'E' && letter != 'B') {
+        pitch++;
+        at++;
+    }
+    else if (at < length && key[at] == 'b' && letter != 'C' && letter != 'F') {
+        pitch = (pitch + 11) % 12;
+        at++;
+    }
+    return pitch;
+}
+
+int tonicPitch(const string& key, size_t& at) {
+    return tonicPitch(key.data(), key.size(), at);
+}
+
+/* Parses the length characters at key into a key ID without copying
+ * them, or returns -1 if they do not name a major or minor key.
+ */
+KeyId keyIdAt(const char* key, size_t length) {
+    size_t at = 0;
+    int pitch = tonicPitch(key, length, at);
+    if (pitch < 0 || length - at != 6 || key[at] != ' ') {
+        return -1;
+    }
+    if (memcmp(key + at + 1, "major", 5) == 0) {
+        return keyFromPitch(pitch, false);
+    }
+    if (memcmp(key + at + 1, "minor", 5) == 0) {
+        return keyFromPitch(pitch, true);
+    }
+    return -1;
+}
+
+/* Parses a key such as "C major" or "Eb minor" into its ID, so that
+ * enharmonic spellings are normalized once, at input time.
+ */
+KeyId keyId(const string& key) {
+    KeyId id = keyIdAt(key.data(), key.size());
+    if (id < 0) {
+        error("keyId: \"" + key + "\" is not a major or minor key");
+    }
+    return id;
+}
+
+string keyName(KeyId id) {
+    if (id < 0 || id >= NUM_KEYS) {
+        error("keyName: no key has ID " + to_string(id));
+    }
+    return KEY_NAMES[id];
+}
+
+/* Packs a set of relation numbers 0-5 into the 6-bit index used by
+ * relatedMask; other numbers allow nothing, as before.
+ */
+int allowedMask(const Set<int>& allowed) {
+    int mask = 0;
+    for (int relation : allowed) {
+        if (relation >= 0 && relation < NUM_RELATIONS) {
+            mask |= 1 << relation;
+        }
+    }
+    return mask;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "set.h"
+#include "vector.h"
+
+/* The 24 major and minor keys as small integer IDs. IDs are numbered in
+ * alphabetical order of the keys' standard spellings, so visiting the
+ * IDs in a bitmask from the lowest bit up visits the keys in exactly
+ * the order a Set<string> of their names would.
+ */
+typedef int KeyId;
+typedef uint32_t KeyMask;
+
+const int NUM_KEYS = 24;
+const int NUM_RELATIONS = 6;
+const int NUM_ALLOWED_SETS = 1 << NUM_RELATIONS;
+
+/* Pitch class of each ID, counted in semitones up from A, and whether
+ * it is a minor key.
+ */
+constexpr int KEY_PITCH[NUM_KEYS] = {0, 0, 11, 2, 2, 1, 1, 3, 3, 4, 5, 5, 6, 4, 7, 7, 6, 8, 8, 9, 9, 10, 10, 11};
+constexpr bool KEY_MINOR[NUM_KEYS] = {false, true, false, false, true, false, true, false, true, true, false, true,
+                                      true, false, false, true, false, false, true, false, true, false, true, true};
+
+constexpr KeyId keyFromPitch(int pitch, bool minor) {
+    for (KeyId id = 0; id < NUM_KEYS; id++) {
+        if (KEY_PITCH[id] == (pitch % 12 + 12) % 12 && KEY_MINOR[id] == minor) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+/* The key reached from id by each of the six relations numbered in
+ * relatedKeys: parallel, supertonic, mediant, subdominant, dominant and
+ * submediant (the relative minor), each taken from the major key's
+ * point of view and mirrored for minor keys.
+ */
+constexpr KeyId relatedKey(KeyId id, int relation) {
+    const int majorSteps[NUM_RELATIONS] = {0, 2, 4, 5, 7, 9};
+    const bool majorToMinor[NUM_RELATIONS] = {true, true, true, false, false, true};
+    int pitch = KEY_PITCH[id];
+    if (KEY_MINOR[id]) {
+        return keyFromPitch(pitch - majorSteps[relation], !majorToMinor[relation]);
+    }
+    return keyFromPitch(pitch + majorSteps[relation], majorToMinor[relation]);
+}
+
+/* Position of a key's signature on the circle of fifths, in sharps
+ * modulo 12 (C major and A minor at 0), and the number of steps around
+ * the circle between two keys.
+ */
+constexpr int circleOfFifths(KeyId id) {
+    int majorPitch = KEY_MINOR[id] ? KEY_PITCH[id] + 3 : KEY_PITCH[id];
+    return (7 * (majorPitch + 9)) % 12;
+}
+
+constexpr int fifthsDistance(KeyId a, KeyId b) {
+    int steps = (circleOfFifths(a) - circleOfFifths(b) + 12) % 12;
+    return steps <= 6 ? steps : 12 - steps;
+}
+
+/* RELATED_MASKS[allowed][id] has a bit set for every key id may
+ * modulate to using only the relations in the 6-bit allowed set, so
+ * finding the neighbours of a key is a single table lookup, and
+ * dropping visited ones a single AND.
+ */
+struct RelatedMaskTable {
+    KeyMask masks[NUM_ALLOWED_SETS][NUM_KEYS];
+};
+
+constexpr RelatedMaskTable buildRelatedMasks() {
+    RelatedMaskTable table = {};
+    for (int allowed = 0; allowed < NUM_ALLOWED_SETS; allowed++) {
+        for (KeyId id = 0; id < NUM_KEYS; id++) {
+            KeyMask mask = 0;
+            for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+                if (allowed & (1 << relation)) {
+                    mask |= KeyMask(1) << relatedKey(id, relation);
+                }
+            }
+            table.masks[allowed][id] = mask;
+        }
+    }
+    return table;
+}
+
+constexpr RelatedMaskTable RELATED_MASKS = buildRelatedMasks();
+
+constexpr KeyMask relatedMask(KeyId id, int allowed) {
+    return RELATED_MASKS.masks[allowed][id];
+}
+
+/* The allowed set for walking edges backwards. Subdominant and dominant
+ * undo each other, and every other relation is its own inverse, so the
+ * keys that reach id are relatedMask(id, reversedRelations(allowed)).
+ */
+constexpr int reversedRelations(int allowed) {
+    return (allowed & ~0x18) | (allowed & 0x08) << 1 | (allowed & 0x10) >> 1;
+}
+
+int tonicPitch(const char* key, size_t length, size_t& at);
+int tonicPitch(const std::string& key, size_t& at);
+KeyId keyIdAt(const char* key, size_t length);
+KeyId keyId(const std::string& key);
+std::string keyName(KeyId id);
+int allowedMask(const Set<int>& allowed);
@@ -0,0 +1,354 @@
+#include "shortestpaths.h"
+#include <chrono>
+#include <climits>
+#include "error.h"
+#include "modulate.h"
+#include "testing/SimpleTest.h"
+
+using namespace std;
+
+void ShortestPathDag::addEdge(int from, int to) {
+    successors[from].push_back(to);
+}
+
+/* Counts the paths from each node to the target, one layer at a time
+ * from the target's layer back to the source, and drops the edges into
+ * nodes that lead nowhere. Counts too large for a long long are held
+ * at LLONG_MAX.
+ */
+void ShortestPathDag::finish(const vector<int>& layer) {
+    if (depth < 0) {
+        return;
+    }
+    vector<vector<int>> layers(depth + 1);
+    for (int node = 0; node < int(layer.size()); node++) {
+        if (layer[node] >= 0 && layer[node] <= depth) {
+            layers[layer[node]].push_back(node);
+        }
+    }
+    ways[target] = 1;
+    for (int at = depth - 1; at >= 0; at--) {
+        for (int node : layers[at]) {
+            vector<int>& next = successors[node];
+            next.erase(remove_if(next.begin(), next.end(), [&](int to) { return ways[to] == 0; }), next.end());
+            for (int to : next) {
+                ways[node] = ways[to] > LLONG_MAX - ways[node] ? LLONG_MAX : ways[node] + ways[to];
+            }
+        }
+    }
+}
+
+/* The number of edges on each shortest path, or -1 if the target
+ * cannot be reached.
+ */
+int ShortestPathDag::length() const {
+    return depth;
+}
+
+long long ShortestPathDag::count() const {
+    return ways[source];
+}
+
+/* The path at position index in the listing, found by walking down from
+ * the source and skipping over whole subtrees by their counts.
+ */
+Vector<int> ShortestPathDag::path(long long index) const {
+    if (index < 0 || index >= count()) {
+        error("ShortestPathDag: there is no path " + to_string(index) + " of " + to_string(count()));
+    }
+    Vector<int> path = {source};
+    for (int node = source; node != target;) {
+        for (int to : successors[node]) {
+            if (index < ways[to]) {
+                node = to;
+                break;
+            }
+            index -= ways[to];
+        }
+        path.add(node);
+    }
+    return path;
+}
+
+ShortestPathDag::Iterator ShortestPathDag::paths() const {
+    return Iterator(*this);
+}
+
+ShortestPathDag::Iterator::Iterator(const ShortestPathDag& dag) : dag(dag), done(dag.count() == 0) {
+    if (!done) {
+        nodes.push_back(dag.source);
+        descend();
+    }
+}
+
+/* Follows first edges down to the target. Every edge left in the DAG
+ * leads there, so this never has to back up.
+ */
+void ShortestPathDag::Iterator::descend() {
+    while (nodes.back() != dag.target) {
+        edges.push_back(0);
+        nodes.push_back(dag.successors[nodes.back()][0]);
+    }
+}
+
+bool ShortestPathDag::Iterator::hasNext() const {
+    return !done;
+}
+
+/* Returns the current path and moves on to the next one, by backing up
+ * to the deepest node with an edge not yet taken.
+ */
+Vector<int> ShortestPathDag::Iterator::next() {
+    if (done) {
+        error("ShortestPathDag: no paths are left");
+    }
+    Vector<int> path;
+    for (int node : nodes) {
+        path.add(node);
+    }
+    while (!edges.empty()) {
+        nodes.pop_back();
+        int edge = edges.back() + 1;
+        edges.pop_back();
+        if (edge < int(dag.successors[nodes.back()].size())) {
+            edges.push_back(edge);
+            nodes.push_back(dag.successors[nodes.back()][edge]);
+            descend();
+            return path;
+        }
+    }
+    done = true;
+    return path;
+}
+
+/** Solution 5: Counting and Listing Modulations
+ * Time Complexity: O(V + E) to build the DAG and count its paths, then
+ * O(L) per path listed. Yen's algorithm runs O(kL) breadth-first
+ * searches for k paths of length up to L.
+ **/
+
+/* The number of shortest paths from startKey to endKey, or 0 if there
+ * is no path.
+ */
+long long countModulations(string startKey, string endKey, Set<int> allowed) {
+    return ShortestPathDag(KeyGraph{allowedMask(allowed)}, keyId(startKey), keyId(endKey)).count();
+}
+
+/* Up to limit of the shortest paths, in alphabetical order of the keys
+ * along them, so the first is the one modulateBFS returns.
+ */
+Vector<Stack<string>> modulateAllShortest(string startKey, string endKey, Set<int> allowed, int limit) {
+    ShortestPathDag dag(KeyGraph{allowedMask(allowed)}, keyId(startKey), keyId(endKey));
+    Vector<Stack<string>> paths;
+    for (ShortestPathDag::Iterator it = dag.paths(); it.hasNext() && paths.size() < limit;) {
+        paths.add(formatPath(it.next(), startKey, endKey));
+    }
+    return paths;
+}
+
+/* The k shortest paths that visit no key twice, shortest first, which
+ * may be longer than the shortest path once those run out.
+ */
+Vector<Stack<string>> modulateKShortest(string startKey, string endKey, Set<int> allowed, int k) {
+    Vector<Stack<string>> paths;
+    for (const Vector<KeyId>& path : kShortestPaths(KeyGraph{allowedMask(allowed)}, keyId(startKey), keyId(endKey), k)) {
+        paths.add(formatPath(path, startKey, endKey));
+    }
+    return paths;
+}
+
+
+/* * * * * * * * * * Test cases below this point * * * * * * * * * */
+
+/* Every simple path from the end of path to end with at most maxLength
+ * edges in all, found by exhaustive depth-first search.
+ */
+static void allSimplePaths(KeyId end, int allowed, Vector<KeyId>& path, KeyMask onPath, int maxLength,
+                           Vector<Vector<KeyId>>& paths) {
+    if (path.back() == end) {
+        paths.add(path);
+        return;
+    }
+    if (path.size() > maxLength) {
+        return;
+    }
+    for (KeyMask next = relatedMask(path.back(), allowed) & ~onPath; next != 0; next &= next - 1) {
+        KeyId neighbor = __builtin_ctz(next);
+        path.add(neighbor);
+        allSimplePaths(end, allowed, path, onPath | KeyMask(1) << neighbor, maxLength, paths);
+        path.removeBack();
+    }
+}
+
+static Vector<Vector<KeyId>> allSimplePaths(KeyId start, KeyId end, int allowed, int maxLength) {
+    Vector<Vector<KeyId>> paths;
+    Vector<KeyId> path = {start};
+    allSimplePaths(end, allowed, path, KeyMask(1) << start, maxLength, paths);
+    return paths;
+}
+
+STUDENT_TEST("The shortest path DAG counts and lists every shortest path") {
+    for (int allowed : {0x3f, 0x18, 0x29, 0x15, 0x06, 0x01}) {
+        for (KeyId start = 0; start < NUM_KEYS; start++) {
+            for (KeyId end = 0; end < NUM_KEYS; end++) {
+                long long expanded = 0;
+                Vector<KeyId> shortest = modulateBFSIds(start, end, allowed, expanded);
+                ShortestPathDag dag(KeyGraph{allowed}, start, end);
+                EXPECT_EQUAL(dag.length(), shortest.size() - 1);
+                if (shortest.isEmpty()) {
+                    EXPECT_EQUAL(dag.count(), 0);
+                    EXPECT(!dag.paths().hasNext());
+                    continue;
+                }
+                Vector<Vector<KeyId>> expected;
+                for (const Vector<KeyId>& path : allSimplePaths(start, end, allowed, dag.length())) {
+                    if (path.size() == shortest.size()) {
+                        expected.add(path);
+                    }
+                }
+                EXPECT_EQUAL(dag.count(), expected.size());
+                Vector<Vector<KeyId>> listed;
+                for (ShortestPathDag::Iterator it = dag.paths(); it.hasNext();) {
+                    listed.add(it.next());
+                }
+                EXPECT(listed == expected);
+                EXPECT(listed[0] == shortest);
+                for (int i = 0; i < listed.size(); i++) {
+                    EXPECT(dag.path(i) == listed[i]);
+                }
+            }
+        }
+    }
+    EXPECT_EQUAL(countModulations("C major", "C major", {0, 1, 2, 3, 4, 5}), 1);
+    EXPECT_EQUAL(countModulations("G minor", "Ab major", {1}), 0);
+    Vector<Stack<string>> paths = modulateAllShortest("C major", "Bb minor", {0, 1, 2, 3, 4, 5}, 100);
+    EXPECT_EQUAL(paths.size(), countModulations("C major", "Bb minor", {0, 1, 2, 3, 4, 5}));
+    EXPECT_EQUAL(paths[0], modulateBFS("C major", "Bb minor", {0, 1, 2, 3, 4, 5}));
+    EXPECT_EQUAL(modulateAllShortest("C major", "Bb minor", {0, 1, 2, 3, 4, 5}, 2).size(), 2);
+    EXPECT_ERROR(ShortestPathDag(KeyGraph{0x3f}, 0, 5).path(1000));
+}
+
+STUDENT_TEST("Yen's algorithm lists simple paths shortest first") {
+    for (int allowed : {0x3f, 0x18, 0x29, 0x15, 0x06}) {
+        for (KeyId start = 0; start < NUM_KEYS; start += 5) {
+            for (KeyId end = 0; end < NUM_KEYS; end += 3) {
+                Vector<Vector<KeyId>> paths = kShortestPaths(KeyGraph{allowed}, start, end, 12);
+                if (paths.isEmpty()) {
+                    long long expanded = 0;
+                    EXPECT(modulateBFSIds(start, end, allowed, expanded).isEmpty());
+                    continue;
+                }
+                /* Compare against every simple path no longer than the
+                 * last one listed
+                 */
+                int longest = paths.back().size() - 1;
+                Vector<Vector<KeyId>> all = allSimplePaths(start, end, allowed, longest);
+                Vector<int> expectedLengths;
+                for (const Vector<KeyId>& path : all) {
+                    expectedLengths.add(path.size());
+                }
+                expectedLengths.sort();
+                Set<Vector<KeyId>> distinct;
+                for (int i = 0; i < paths.size(); i++) {
+                    EXPECT_EQUAL(paths[i].size(), expectedLengths[i]);
+                    EXPECT(all.contains(paths[i]));
+                    distinct.add(paths[i]);
+                }
+                EXPECT_EQUAL(distinct.size(), paths.size());
+                EXPECT_EQUAL(paths.size(), min(12, all.size()));
+            }
+        }
+    }
+    Vector<Stack<string>> paths = modulateKShortest("C major", "G major", {0, 1, 2, 3, 4, 5}, 5);
+    EXPECT_EQUAL(paths.size(), 5);
+    EXPECT_EQUAL(paths[0].size(), 2);
+    EXPECT(paths[1].size() > 2);
+    EXPECT_EQUAL(modulateKShortest("G minor", "Ab major", {1}, 5).size(), 0);
+}
+
+STUDENT_TEST("Time trials on counting and listing shortest paths against exhaustive search") {
+    Vector<int> allowedSets = {0x3f, 0x29, 0x15};
+    for (int allowed : allowedSets) {
+        long long counted = 0;
+        long long listed = 0;
+        auto countAllPairs = [&]() {
+            for (KeyId start = 0; start < NUM_KEYS; start++) {
+                for (KeyId end = 0; end < NUM_KEYS; end++) {
+                    ShortestPathDag dag(KeyGraph{allowed}, start, end);
+                    counted += dag.count();
+                    for (ShortestPathDag::Iterator it = dag.paths(); it.hasNext(); it.next()) {
+                        listed++;
+                    }
+                }
+            }
+        };
+        long long found = 0;
+        auto searchAllPairs = [&]() {
+            for (KeyId start = 0; start < NUM_KEYS; start++) {
+                for (KeyId end = 0; end < NUM_KEYS; end++) {
+                    long long expanded = 0;
+                    int length = modulateBFSIds(start, end, allowed, expanded).size() - 1;
+                    for (const Vector<KeyId>& path : allSimplePaths(start, end, allowed, length)) {
+                        found += path.size() == length + 1;
+                    }
+                }
+            }
+        };
+        TIME_OPERATION(__builtin_popcount(allowed), countAllPairs());
+        TIME_OPERATION(__builtin_popcount(allowed), searchAllPairs());
+        EXPECT_EQUAL(counted, found);
+        EXPECT_EQUAL(listed, found);
+        cout << "    " << found << " shortest paths over all pairs" << endl;
+    }
+    for (int k : {10, 100, 1000}) {
+        TIME_OPERATION(k, kShortestPaths(KeyGraph{0x3f}, keyId("C major"), keyId("F# major"), k));
+    }
+}
+
+/* A chain of n diamonds: node 3i leads to 3i + 1 and 3i + 2, which both
+ * lead to 3i + 3, so there are 2^n shortest paths from 0 to 3n.
+ */
+struct DiamondChain {
+    int n;
+
+    int size() const {
+        return 3 * n + 1;
+    }
+
+    template <typename F>
+    void forEachSuccessor(int node, F visit) const {
+        if (node % 3 == 0 && node < 3 * n) {
+            visit(node + 1);
+            visit(node + 2);
+        }
+        else if (node % 3 != 0) {
+            visit(node - node % 3 + 3);
+        }
+    }
+};
+
+/* Counts paths of exactly depth edges by trying every one. */
+static long long countByDepthFirst(const DiamondChain& graph, int node, int target, int depth) {
+    if (depth == 0) {
+        return node == target;
+    }
+    long long paths = 0;
+    graph.forEachSuccessor(node, [&](int next) { paths += countByDepthFirst(graph, next, target, depth - 1); });
+    return paths;
+}
+
+STUDENT_TEST("Time trials on counting exponentially many shortest paths") {
+    for (int n : {10, 15, 20, 60}) {
+        DiamondChain graph = {n};
+        long long counted = 0;
+        TIME_OPERATION(n, counted = ShortestPathDag(graph, 0, 3 * n).count());
+        EXPECT_EQUAL(counted, n < 63 ? 1LL << n : LLONG_MAX);
+        if (n <= 20) {
+            long long searched = 0;
+            TIME_OPERATION(n, searched = countByDepthFirst(graph, 0, 3 * n, 2 * n));
+            EXPECT_EQUAL(searched, counted);
+        }
+    }
+    ShortestPathDag dag(DiamondChain{40}, 0, 120);
+    EXPECT_EQUAL(dag.path(dag.count() - 1).back(), 120);
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "graphsearch.h"
+#include "musicalkey.h"
+#include "set.h"
+#include "stack.h"
+#include "vector.h"
+
+/* Every shortest path from a source to a target, held as the layered
+ * DAG a breadth-first search leaves behind: an edge is kept when it
+ * leads one layer further out and the target can still be reached
+ * from its far end in the layers that remain. The number of paths
+ * through each node is counted once, from the target back, after
+ * which the paths can be counted, listed one at a time, or picked out
+ * by their position in the list without searching again. Paths are
+ * listed in lexicographic order of their nodes, so the first one is the
+ * one a breadth-first search visiting lowest nodes first would return.
+ *
+ * The graph is any type that bidirectionalSearch accepts; only its
+ * successors are used.
+ */
+class ShortestPathDag {
+public:
+    template <typename Graph>
+    ShortestPathDag(const Graph& graph, int source, int target);
+
+    int length() const;
+    long long count() const;
+    Vector<int> path(long long index) const;
+
+    /* Lists the paths one at a time. Each call to next costs time in
+     * proportion to the path's length, however many paths there are.
+     */
+    class Iterator {
+    public:
+        explicit Iterator(const ShortestPathDag& dag);
+        bool hasNext() const;
+        Vector<int> next();
+
+    private:
+        void descend();
+
+        const ShortestPathDag& dag;
+        std::vector<int> nodes;
+        std::vector<int> edges;
+        bool done;
+    };
+
+    Iterator paths() const;
+
+private:
+    void addEdge(int from, int to);
+    void finish(const std::vector<int>& layer);
+
+    int source;
+    int target;
+    int depth = -1;
+    std::vector<std::vector<int>> successors;
+    std::vector<long long> ways;
+};
+
+template <typename Graph>
+ShortestPathDag::ShortestPathDag(const Graph& graph, int source, int target)
+    : source(source), target(target), successors(graph.size()), ways(graph.size(), 0) {
+    std::vector<int> layer(graph.size(), -1);
+    std::vector<int> frontier = {source};
+    std::vector<int> next;
+    layer[source] = 0;
+    /* Grow whole layers until the one holding the target is complete */
+    for (int at = 0; layer[target] < 0 && !frontier.empty(); at++) {
+        next.clear();
+        for (int node : frontier) {
+            graph.forEachSuccessor(node, [&](int neighbor) {
+                if (layer[neighbor] < 0) {
+                    layer[neighbor] = at + 1;
+                    next.push_back(neighbor);
+                }
+                if (layer[neighbor] == at + 1) {
+                    addEdge(node, neighbor);
+                }
+            });
+        }
+        frontier.swap(next);
+    }
+    depth = layer[target];
+    finish(layer);
+}
+
+/* Yen's algorithm for the k shortest simple paths from source to
+ * target, shortest first. Each path after the first is found by
+ * leaving an earlier one at some node, the spur, and taking the
+ * shortest way on to the target that avoids the nodes before the spur
+ * and every edge out of the spur already taken by a listed path with
+ * the same beginning. The spur paths come from a breadth-first search
+ * visiting lowest nodes first, and candidates of equal length are
+ * ordered by their nodes, so the result is the same on every run.
+ * Returns fewer than k paths when there are no more.
+ */
+template <typename Graph>
+Vector<Vector<int>> kShortestPaths(const Graph& graph, int source, int target, int k) {
+    int n = graph.size();
+    auto toVector = [](const std::vector<int>& path) {
+        Vector<int> copy;
+        for (int node : path) {
+            copy.add(node);
+        }
+        return copy;
+    };
+    Vector<Vector<int>> found;
+    std::set<std::pair<int, std::vector<int>>> candidates;
+    std::vector<int> parent(n);
+
+    /* Shortest path from spur to target avoiding the blocked nodes and
+     * the blocked first steps, or an empty vector
+     */
+    auto spurPath = [&](int spur, const NodeSet& blocked, const NodeSet& firstSteps) {
+        NodeSet seen = blocked;
+        seen.add(spur);
+        std::vector<int> queue = {spur};
+        for (size_t head = 0; head < queue.size(); head++) {
+            int node = queue[head];
+            if (node == target) {
+                std::vector<int> path;
+                for (int at = target; at != spur; at = parent[at]) {
+                    path.push_back(at);
+                }
+                path.push_back(spur);
+                return std::vector<int>(path.rbegin(), path.rend());
+            }
+            graph.forEachSuccessor(node, [&](int neighbor) {
+                if (!seen.contains(neighbor) && !(node == spur && firstSteps.contains(neighbor))) {
+                    seen.add(neighbor);
+                    parent[neighbor] = node;
+                    queue.push_back(neighbor);
+                }
+            });
+        }
+        return std::vector<int>();
+    };
+
+    std::vector<int> first = spurPath(source, NodeSet(n), NodeSet(n));
+    if (first.empty() || k <= 0) {
+        return found;
+    }
+    found.add(toVector(first));
+    while (found.size() < k) {
+        const Vector<int>& last = found.back();
+        NodeSet blocked(n);
+        for (int i = 0; i + 1 < last.size(); i++) {
+            NodeSet firstSteps(n);
+            for (const Vector<int>& path : found) {
+                if (path.size() > i + 1 && std::equal(path.begin(), path.begin() + i + 1, last.begin())) {
+                    firstSteps.add(path[i + 1]);
+                }
+            }
+            std::vector<int> spur = spurPath(last[i], blocked, firstSteps);
+            if (!spur.empty()) {
+                std::vector<int> candidate(last.begin(), last.begin() + i);
+                candidate.insert(candidate.end(), spur.begin(), spur.end());
+                candidates.insert({int(candidate.size()), candidate});
+            }
+            blocked.add(last[i]);
+        }
+        if (candidates.empty()) {
+            break;
+        }
+        found.add(toVector(candidates.begin()->second));
+        candidates.erase(candidates.begin());
+    }
+    return found;
+}
+
+long long countModulations(std::string startKey, std::string endKey, Set<int> allowed);
+Vector<Stack<std::string>> modulateAllShortest(std::string startKey, std::string endKey, Set<int> allowed, int limit);
+Vector<Stack<std::string>> modulateKShortest(std::string startKey, std::string endKey, Set<int> allowed, int k);
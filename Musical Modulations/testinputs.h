@@ -0,0 +1,56 @@
+#pragma once
+
+#include <random>
+#include <sstream>
+#include <string>
+#include "musicalkey.h"
+#include "set.h"
+
+/* Inputs shared by the tests here and the benchmarks, so both always
+ * exercise the same allowed sets, rule tables and corpora.
+ */
+
+/* The relation numbers in a 6-bit allowed set, as modulateBFS takes them. */
+inline Set<int> relationsOf(int allowed) {
+    Set<int> relations;
+    for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+        if (allowed & (1 << relation)) {
+            relations.add(relation);
+        }
+    }
+    return relations;
+}
+
+/* A table of numModes modes on random degrees and numRules rules, each
+ * from a random mode (or every mode) to a random mode by a random
+ * interval, from a fixed seed.
+ */
+inline std::string generatedTable(int numModes, int numRules, unsigned seed) {
+    std::mt19937 random(seed);
+    std::ostringstream table;
+    for (int mode = 0; mode < numModes; mode++) {
+        table << "mode m" << mode << " " << random() % 12 << "\n";
+    }
+    for (int rule = 0; rule < numRules; rule++) {
+        std::string from = random() % 4 == 0 ? "*" : "m" + std::to_string(random() % numModes);
+        std::string to = random() % 4 == 0 ? "=" : "m" + std::to_string(random() % numModes);
+        table << "rule r" << rule << " " << from << " " << to << " " << int(random() % 12) - 6 << "\n";
+    }
+    return table.str();
+}
+
+/* A corpus of numPieces pieces of 2 to 40 random keys each, from a fixed
+ * seed.
+ */
+inline std::string generatedCorpus(int numPieces, unsigned seed) {
+    std::mt19937 random(seed);
+    std::string corpus;
+    for (int piece = 0; piece < numPieces; piece++) {
+        corpus += "piece " + std::to_string(piece);
+        for (int keys = 2 + random() % 39; keys > 0; keys--) {
+            corpus += ", " + keyName(random() % NUM_KEYS);
+        }
+        corpus += "\n";
+    }
+    return corpus;
+}
@@ -0,0 +1,585 @@
+#include "tonalgraph.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include "error.h"
+#include "musicalkey.h"
+#include "modulate.h"
+#include "testinputs.h"
+#include "testing/SimpleTest.h"
+
+using namespace std;
+
+/* Spelling of each tonic in node names, counted up from A, for modes
+ * other than major and minor, which take keyName's spellings.
+ */
+static const string TONIC_NAMES[12] = {"A", "Bb", "B", "C", "Db", "D", "Eb", "E", "F", "F#", "G", "Ab"};
+
+/* The 24 major and minor keys and the six relations of relatedKeys. */
+static const string STANDARD_TABLE =
+    "mode major 0\n"
+    "mode minor 9\n"
+    "rule parallel major minor 0\n"
+    "rule parallel minor major 0\n"
+    "rule supertonic major minor 2\n"
+    "rule supertonic minor major -2\n"
+    "rule mediant major minor 4\n"
+    "rule mediant minor major -4\n"
+    "rule subdominant major major 5\n"
+    "rule subdominant minor minor -5\n"
+    "rule dominant major major 7\n"
+    "rule dominant minor minor -7\n"
+    "rule relative * * sig\n";
+
+/* The seven diatonic modes, each joined to the other modes on its tonic
+ * and on its key signature, and to its dominant and subdominant.
+ */
+static const string MODAL_TABLE =
+    "mode ionian 0\n"
+    "mode dorian 2\n"
+    "mode phrygian 4\n"
+    "mode lydian 5\n"
+    "mode mixolydian 7\n"
+    "mode aeolian 9\n"
+    "mode locrian 11\n"
+    "rule parallel * * 0\n"
+    "rule relative * * sig\n"
+    "rule dominant * = 7\n"
+    "rule subdominant * = 5\n";
+
+/* Returns the modes a rule names, or the single mode equal to it when
+ * sameAs is given and the name is "=".
+ */
+static Vector<int> modesNamed(const Vector<string>& modes, const string& name, int sameAs, int line) {
+    Vector<int> found;
+    if (name == "*") {
+        for (int mode = 0; mode < modes.size(); mode++) {
+            found.add(mode);
+        }
+    }
+    else if (name == "=" && sameAs >= 0) {
+        found.add(sameAs);
+    }
+    else if (modes.contains(name)) {
+        found.add(modes.indexOf(name));
+    }
+    else {
+        error("TonalGraph: line " + to_string(line) + " uses unknown mode \"" + name + "\"");
+    }
+    return found;
+}
+
+/* Reads a table in the format described in tonalgraph.h. Malformed
+ * lines are reported with their line numbers.
+ */
+TonalGraph TonalGraph::parse(istream& table) {
+    TonalGraph graph;
+    Vector<Edge> edges;
+    string text;
+    for (int line = 1; getline(table, text); line++) {
+        text = text.substr(0, text.find('#'));
+        istringstream words(text);
+        string kind;
+        if (!(words >> kind)) {
+            continue;
+        }
+        string extra;
+        if (kind == "mode") {
+            string name;
+            int degree;
+            if (!(words >> name >> degree) || (words >> extra) || degree < 0 || degree > 11) {
+                error("TonalGraph: line " + to_string(line) + " should be \"mode <name> <degree 0-11>\"");
+            }
+            if (name == "*" || name == "=" || graph.modes.contains(name)) {
+                error("TonalGraph: line " + to_string(line) + " redefines mode \"" + name + "\"");
+            }
+            if (!edges.isEmpty()) {
+                error("TonalGraph: line " + to_string(line) + " defines a mode after the first rule");
+            }
+            graph.modes.add(name);
+            graph.degrees.add(degree);
+        }
+        else if (kind == "rule") {
+            string name;
+            string fromName;
+            string toName;
+            string interval;
+            if (!(words >> name >> fromName >> toName >> interval) || (words >> extra)) {
+                error("TonalGraph: line " + to_string(line) + " should be \"rule <name> <from> <to> <interval>\"");
+            }
+            bool keepSignature = interval == "sig";
+            int semitones = 0;
+            if (!keepSignature) {
+                size_t used = 0;
+                try {
+                    semitones = stoi(interval, &used);
+                }
+                catch (const exception&) {
+                    used = 0;
+                }
+                if (used == 0 || used != interval.size()) {
+                    error("TonalGraph: line " + to_string(line) + " has interval \"" + interval +
+                          "\", which is neither a number of semitones nor sig");
+                }
+            }
+            if (!graph.rules.contains(name)) {
+                graph.rules.add(name);
+            }
+            int rule = graph.rules.indexOf(name);
+            int numModes = graph.modes.size();
+            for (int from : modesNamed(graph.modes, fromName, -1, line)) {
+                for (int to : modesNamed(graph.modes, toName, from, line)) {
+                    int shift = keepSignature ? graph.degrees[to] - graph.degrees[from] : semitones;
+                    for (int tonic = 0; tonic < 12; tonic++) {
+                        int next = ((tonic + shift) % 12 + 12) % 12;
+                        edges.add({tonic * numModes + from, next * numModes + to, rule});
+                    }
+                }
+            }
+        }
+        else {
+            error("TonalGraph: line " + to_string(line) + " starts with \"" + kind + "\", not mode or rule");
+        }
+    }
+    if (graph.modes.isEmpty()) {
+        error("TonalGraph: the table defines no modes");
+    }
+    graph.build(edges);
+    return graph;
+}
+
+TonalGraph TonalGraph::load(const string& path) {
+    ifstream in(path);
+    if (!in) {
+        error("TonalGraph: cannot open " + path);
+    }
+    return parse(in);
+}
+
+TonalGraph TonalGraph::standard() {
+    istringstream table(STANDARD_TABLE);
+    return parse(table);
+}
+
+TonalGraph TonalGraph::modal() {
+    istringstream table(MODAL_TABLE);
+    return parse(table);
+}
+
+/* Lays the edges out in both row arrays. A stable sort by endpoints
+ * keeps the earliest rule for each repeated edge first, where the
+ * duplicates are dropped.
+ */
+void TonalGraph::build(Vector<Edge>& edges) {
+    int n = size();
+    stable_sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+        return a.from != b.from ? a.from < b.from : a.to < b.to;
+    });
+    offsets.assign(n + 1, 0);
+    targets.clear();
+    edgeRules.clear();
+    for (int i = 0; i < edges.size(); i++) {
+        const Edge& edge = edges[i];
+        if (edge.from == edge.to || (i > 0 && edges[i - 1].from == edge.from && edges[i - 1].to == edge.to)) {
+            continue;
+        }
+        offsets[edge.from + 1]++;
+        targets.push_back(edge.to);
+        edgeRules.push_back(edge.rule);
+    }
+    for (int node = 0; node < n; node++) {
+        offsets[node + 1] += offsets[node];
+    }
+
+    /* The reverse rows, filled in order of source, come out sorted too */
+    reverseOffsets.assign(n + 1, 0);
+    for (int to : targets) {
+        reverseOffsets[to + 1]++;
+    }
+    for (int node = 0; node < n; node++) {
+        reverseOffsets[node + 1] += reverseOffsets[node];
+    }
+    sources.assign(targets.size(), 0);
+    vector<int> filled(reverseOffsets.begin(), reverseOffsets.end() - 1);
+    for (int from = 0; from < n; from++) {
+        for (int edge = offsets[from]; edge < offsets[from + 1]; edge++) {
+            sources[filled[targets[edge]]++] = from;
+        }
+    }
+}
+
+int TonalGraph::size() const {
+    return 12 * modes.size();
+}
+
+int TonalGraph::numModes() const {
+    return modes.size();
+}
+
+int TonalGraph::numEdges() const {
+    return targets.size();
+}
+
+Vector<string> TonalGraph::ruleNames() const {
+    return rules;
+}
+
+/* Parses a key such as "D dorian" into its node. "major" and "minor"
+ * also name the modes on degrees 0 and 9 when no mode has that name.
+ */
+int TonalGraph::node(const string& key) const {
+    size_t at = 0;
+    int tonic = tonicPitch(key, at);
+    int mode = -1;
+    if (tonic >= 0 && at < key.size() && key[at] == ' ') {
+        string name = key.substr(at + 1);
+        mode = modes.indexOf(name);
+        if (mode < 0 && (name == "major" || name == "minor")) {
+            mode = degrees.indexOf(name == "major" ? 0 : 9);
+        }
+    }
+    if (mode < 0) {
+        error("TonalGraph: \"" + key + "\" is not a key in any mode of this graph");
+    }
+    return tonic * modes.size() + mode;
+}
+
+/* Keys in the modes on degrees 0 and 9 are spelled as keyName spells
+ * the major or minor key on the same tonic ("C# minor", not "Db minor"),
+ * so paths through the standard graph name the same keys as the
+ * searches over key IDs.
+ */
+string TonalGraph::nodeName(int node) const {
+    if (node < 0 || node >= size()) {
+        error("TonalGraph: no key has node " + to_string(node));
+    }
+    int tonic = node / modes.size();
+    int mode = node % modes.size();
+    if (degrees[mode] == 0 || degrees[mode] == 9) {
+        string key = keyName(keyFromPitch(tonic, degrees[mode] == 9));
+        return key.substr(0, key.find(' ')) + " " + modes[mode];
+    }
+    return TONIC_NAMES[tonic] + " " + modes[mode];
+}
+
+/* The rule that gave the edge from one node to another, or -1 if there
+ * is no such edge.
+ */
+int TonalGraph::edgeRule(int from, int to) const {
+    auto begin = targets.begin() + offsets[from];
+    auto end = targets.begin() + offsets[from + 1];
+    auto found = lower_bound(begin, end, to);
+    if (found == end || *found != to) {
+        return -1;
+    }
+    return edgeRules[found - targets.begin()];
+}
+
+/* The same graph with only the edges of the named rules. Searching the
+ * copy costs nothing per edge for the rules left out, unlike checking
+ * every edge's rule during a search.
+ */
+TonalGraph TonalGraph::restrictedTo(const Set<string>& allowed) const {
+    vector<bool> keep(rules.size(), false);
+    for (const string& name : allowed) {
+        if (!rules.contains(name)) {
+            error("TonalGraph: there is no rule \"" + name + "\"");
+        }
+        keep[rules.indexOf(name)] = true;
+    }
+    TonalGraph graph;
+    graph.modes = modes;
+    graph.degrees = degrees;
+    graph.rules = rules;
+    Vector<Edge> edges;
+    for (int from = 0; from < size(); from++) {
+        for (int edge = offsets[from]; edge < offsets[from + 1]; edge++) {
+            if (keep[edgeRules[edge]]) {
+                edges.add({from, targets[edge], edgeRules[edge]});
+            }
+        }
+    }
+    graph.build(edges);
+    return graph;
+}
+
+/* Breadth-first search one layer at a time, with the frontier, the next
+ * layer and the visited keys each held as a bitset. Each layer is built
+ * in one of two directions:
+ *
+ * Top-down expands every key in the frontier, scanning the bitset a
+ * 64-bit word at a time so empty stretches of a large graph cost one
+ * test per word, and visits their unvisited successors.
+ *
+ * Bottom-up instead scans every unvisited key's predecessors until it
+ * finds one in the frontier. On dense graphs the middle layers reach
+ * nearly every key, and a top-down step there tests almost all of the
+ * frontier's edges against keys already visited, while a bottom-up step
+ * stops at the first predecessor found, which is usually among the
+ * first few. The target is checked before the rest of the layer, since
+ * nothing else matters once it has a parent.
+ *
+ * A layer goes bottom-up when the frontier's out-edges outnumber a
+ * fourteenth of the edges into unvisited keys, and back top-down once
+ * the frontier shrinks below a twenty-fourth of the keys, the switching
+ * points Beamer et al. found for direction-optimizing BFS.
+ *
+ * Either way each key's parent is the lowest-numbered key in the
+ * previous layer with an edge to it, so the path found does not depend
+ * on the direction and is the same on every run. Returns the nodes from
+ * source to target, or an empty Vector if there is no path; the number
+ * of keys expanded, counting a bottom-up layer as its whole frontier, is
+ * added to expanded.
+ */
+
+static const int TOP_DOWN_RATIO = 14;
+static const int BOTTOM_UP_RATIO = 24;
+
+Vector<int> TonalGraph::shortestPath(int source, int target, long long& expanded) const {
+    int n = size();
+    int words = (n + 63) / 64;
+    /* Reused by every search on this thread */
+    thread_local vector<uint64_t> frontier;
+    thread_local vector<uint64_t> next;
+    thread_local vector<uint64_t> visited;
+    thread_local vector<int> parent;
+    frontier.assign(words, 0);
+    next.assign(words, 0);
+    visited.assign(words, 0);
+    parent.resize(max<size_t>(parent.size(), n));
+    frontier[source >> 6] |= uint64_t(1) << (source & 63);
+    visited[source >> 6] |= uint64_t(1) << (source & 63);
+    parent[source] = source;
+    long long frontierKeys = 1;
+    long long frontierEdges = offsets[source + 1] - offsets[source];
+    long long unvisitedEdges = (long long)(sources.size()) - (reverseOffsets[source + 1] - reverseOffsets[source]);
+    bool bottomUp = false;
+    bool found = source == target;
+    while (!found && frontierKeys > 0) {
+        if (!bottomUp && frontierEdges * TOP_DOWN_RATIO > unvisitedEdges) {
+            bottomUp = true;
+        }
+        else if (bottomUp && frontierKeys * BOTTOM_UP_RATIO < n) {
+            bottomUp = false;
+        }
+        long long nextKeys = 0;
+        long long nextEdges = 0;
+        auto visit = [&](int node, int from) {
+            visited[node >> 6] |= uint64_t(1) << (node & 63);
+            next[node >> 6] |= uint64_t(1) << (node & 63);
+            parent[node] = from;
+            nextKeys++;
+            nextEdges += offsets[node + 1] - offsets[node];
+            unvisitedEdges -= reverseOffsets[node + 1] - reverseOffsets[node];
+        };
+        if (bottomUp) {
+            expanded += frontierKeys;
+            for (int edge = reverseOffsets[target]; edge < reverseOffsets[target + 1] && !found; edge++) {
+                int from = sources[edge];
+                if (frontier[from >> 6] & (uint64_t(1) << (from & 63))) {
+                    parent[target] = from;
+                    found = true;
+                }
+            }
+            for (int word = 0; word < words && !found; word++) {
+                uint64_t unvisited = ~visited[word];
+                if (word == words - 1 && n % 64 != 0) {
+                    unvisited &= (uint64_t(1) << (n % 64)) - 1;
+                }
+                for (uint64_t bits = unvisited; bits != 0; bits &= bits - 1) {
+                    int node = word * 64 + __builtin_ctzll(bits);
+                    for (int edge = reverseOffsets[node]; edge < reverseOffsets[node + 1]; edge++) {
+                        int from = sources[edge];
+                        if (frontier[from >> 6] & (uint64_t(1) << (from & 63))) {
+                            visit(node, from);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        else {
+            for (int word = 0; word < words && !found; word++) {
+                for (uint64_t bits = frontier[word]; bits != 0 && !found; bits &= bits - 1) {
+                    int node = word * 64 + __builtin_ctzll(bits);
+                    expanded++;
+                    for (int edge = offsets[node]; edge < offsets[node + 1]; edge++) {
+                        int neighbor = targets[edge];
+                        if (visited[neighbor >> 6] & (uint64_t(1) << (neighbor & 63))) {
+                            continue;
+                        }
+                        visit(neighbor, node);
+                        if (neighbor == target) {
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        frontier.swap(next);
+        fill(next.begin(), next.end(), 0);
+        frontierKeys = nextKeys;
+        frontierEdges = nextEdges;
+    }
+    if (!found) {
+        return {};
+    }
+    Vector<int> path;
+    for (int at = target; at != source; at = parent[at]) {
+        path.add(at);
+    }
+    path.add(source);
+    path.reverse();
+    return path;
+}
+
+/* Wrapper function that returns the path as a Stack of key names, from
+ * startKey at the bottom to endKey at the top, or an empty Stack if
+ * there is no path. The first and last keys keep the caller's
+ * spellings.
+ */
+Stack<string> modulateModal(const TonalGraph& graph, string startKey, string endKey) {
+    long long expanded = 0;
+    Vector<int> path = graph.shortestPath(graph.node(startKey), graph.node(endKey), expanded);
+    Stack<string> keys;
+    for (int i = 0; i < path.size(); i++) {
+        keys.push(i == path.size() - 1 ? endKey : i == 0 ? startKey : graph.nodeName(path[i]));
+    }
+    return keys;
+}
+
+
+/* * * * * * * * * * Test cases below this point * * * * * * * * * */
+
+STUDENT_TEST("The standard table gives the same graph as relatedKeys") {
+    TonalGraph graph = TonalGraph::standard();
+    EXPECT_EQUAL(graph.size(), 24);
+    EXPECT_EQUAL(graph.numEdges(), 144);
+    Vector<string> names = {"parallel", "supertonic", "mediant", "subdominant", "dominant", "relative"};
+    EXPECT_EQUAL(graph.ruleNames(), names);
+    for (KeyId id = 0; id < NUM_KEYS; id++) {
+        int node = graph.node(keyName(id));
+        EXPECT_EQUAL(graph.nodeName(node), keyName(id));
+        for (KeyId end = 0; end < NUM_KEYS; end++) {
+            Stack<string> keys = modulateModal(graph, keyName(id), keyName(end));
+            EXPECT_EQUAL(keys.size(), modulateBFS(keyName(id), keyName(end), {0, 1, 2, 3, 4, 5}).size());
+            while (!keys.isEmpty()) {
+                string key = keys.pop();
+                EXPECT_EQUAL(keyName(keyId(key)), key);
+            }
+        }
+        for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+            EXPECT_EQUAL(graph.edgeRule(node, graph.node(keyName(relatedKey(id, relation)))), relation);
+        }
+    }
+    for (int allowed = 0; allowed < NUM_ALLOWED_SETS; allowed++) {
+        Set<string> rules;
+        for (int relation = 0; relation < NUM_RELATIONS; relation++) {
+            if (allowed & (1 << relation)) {
+                rules.add(names[relation]);
+            }
+        }
+        TonalGraph restricted = graph.restrictedTo(rules);
+        for (KeyId start = 0; start < NUM_KEYS; start++) {
+            for (KeyId end = 0; end < NUM_KEYS; end++) {
+                long long expanded = 0;
+                Vector<int> path = restricted.shortestPath(graph.node(keyName(start)), graph.node(keyName(end)), expanded);
+                EXPECT_EQUAL(path.size(), modulateBFSIds(start, end, allowed, expanded).size());
+                for (int i = 1; i < path.size(); i++) {
+                    EXPECT(rules.contains(names[graph.edgeRule(path[i - 1], path[i])]));
+                }
+                Vector<int> other = bidirectionalSearch(restricted, path.isEmpty() ? 0 : path[0],
+                                                        path.isEmpty() ? 0 : path.back(), expanded);
+                EXPECT_EQUAL(other.size(), path.isEmpty() ? 1 : path.size());
+            }
+        }
+    }
+}
+
+STUDENT_TEST("The modal table covers all seven modes") {
+    TonalGraph graph = TonalGraph::modal();
+    EXPECT_EQUAL(graph.size(), 84);
+    EXPECT_EQUAL(graph.nodeName(graph.node("D dorian")), "D dorian");
+    EXPECT_EQUAL(graph.nodeName(graph.node("Db aeolian")), "C# aeolian");
+    EXPECT_EQUAL(graph.nodeName(graph.node("Db dorian")), "Db dorian");
+    EXPECT_EQUAL(graph.node("C major"), graph.node("C ionian"));
+    EXPECT_EQUAL(graph.node("A minor"), graph.node("A aeolian"));
+    EXPECT_EQUAL(graph.edgeRule(graph.node("C ionian"), graph.node("D dorian")), 1);
+    EXPECT_EQUAL(graph.edgeRule(graph.node("C ionian"), graph.node("C dorian")), 0);
+    EXPECT_EQUAL(graph.edgeRule(graph.node("C ionian"), graph.node("D ionian")), -1);
+
+    /* Up a fifth, then across to the key with the same signature */
+    Stack<string> path = modulateModal(graph, "C ionian", "F# locrian");
+    EXPECT_EQUAL(path.size(), 3);
+    EXPECT_EQUAL(path.pop(), "F# locrian");
+    EXPECT_EQUAL(modulateModal(graph, "E phrygian", "E phrygian").size(), 1);
+    EXPECT_EQUAL(modulateModal(graph.restrictedTo({"dominant"}), "C dorian", "C lydian").size(), 0);
+    EXPECT_ERROR(graph.node("C major minor"));
+    EXPECT_ERROR(graph.node("H dorian"));
+    EXPECT_ERROR(graph.restrictedTo({"tritone"}));
+}
+
+STUDENT_TEST("Rule tables are parsed strictly") {
+    istringstream good("# two modes\nmode a 0\nmode b 3   # trailing comment\n\nrule up a b 1\nrule up b a -13\n");
+    TonalGraph graph = TonalGraph::parse(good);
+    EXPECT_EQUAL(graph.size(), 24);
+    EXPECT_EQUAL(graph.numEdges(), 24);
+    EXPECT_EQUAL(graph.edgeRule(graph.node("C a"), graph.node("Db b")), 0);
+    EXPECT_EQUAL(graph.edgeRule(graph.node("Db b"), graph.node("C a")), 0);
+
+    Vector<string> bad = {"", "mode a 12\n", "mode a\n", "mode a 0\nmode a 1\n", "mode a 0\nrule r a c 1\n",
+                          "mode a 0\nrule r a a x\n", "mode a 0\nrule r a a 1 2\n", "key a 0\n",
+                          "mode a 0\nrule r a a 1\nmode b 2\n"};
+    for (const string& table : bad) {
+        istringstream in(table);
+        EXPECT_ERROR(TonalGraph::parse(in));
+    }
+    EXPECT_ERROR(TonalGraph::load("no such rule file"));
+}
+
+STUDENT_TEST("Dense generated graphs, searched partly bottom-up, give shortest paths") {
+    for (int numModes : {3, 20, 50}) {
+        istringstream table(generatedTable(numModes, 4 * numModes, numModes + 1));
+        TonalGraph graph = TonalGraph::parse(table);
+        mt19937 random(numModes);
+        for (int query = 0; query < 200; query++) {
+            int source = random() % graph.size();
+            int target = random() % graph.size();
+            long long expanded = 0;
+            Vector<int> path = graph.shortestPath(source, target, expanded);
+            EXPECT_EQUAL(path.size(), bidirectionalSearch(graph, source, target, expanded).size());
+            for (int i = 1; i < path.size(); i++) {
+                EXPECT(graph.edgeRule(path[i - 1], path[i]) != -1);
+            }
+        }
+    }
+}
+
+/* Runs a search between 10000 pairs of keys and reports how many keys
+ * it expanded per second and how long each search took.
+ */
+static void searchPairs(const TonalGraph& graph, const string& label) {
+    mt19937 random(2024);
+    long long expanded = 0;
+    auto begin = chrono::steady_clock::now();
+    for (int query = 0; query < 10000; query++) {
+        graph.shortestPath(random() % graph.size(), random() % graph.size(), expanded);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "    " << label << ": " << graph.size() << " keys, " << graph.numEdges() << " edges, "
+         << (long long)(expanded / max(seconds, 1e-9)) << " keys expanded per second, "
+         << seconds * 1e6 / 10000 << " us per search" << endl;
+}
+
+STUDENT_TEST("Time trials on searching larger generated graphs") {
+    TIME_OPERATION(24, searchPairs(TonalGraph::standard(), "standard"));
+    TIME_OPERATION(84, searchPairs(TonalGraph::modal(), "modal"));
+    for (int numModes : {20, 50, 100}) {
+        istringstream table(generatedTable(numModes, 4 * numModes, numModes));
+        TonalGraph graph = TonalGraph::parse(table);
+        TIME_OPERATION(graph.size(), searchPairs(graph, "generated"));
+    }
+}
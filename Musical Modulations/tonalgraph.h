@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "set.h"
+#include "stack.h"
+#include "vector.h"
+
+/* A key graph over any set of modes, with edges given by named rules
+ * read from a table. Every mode has a key on each of the 12 tonics, so
+ * a graph of m modes has 12m nodes, numbered tonic * m + mode with
+ * tonics counted in semitones up from A, as in musicalkey.h.
+ *
+ * The table has one entry per line; blank lines and text after a '#'
+ * are ignored.
+ *
+ *     mode <name> <degree>
+ *         A mode whose scale starts on the given degree, in semitones,
+ *         of the major scale with the same key signature: ionian 0,
+ *         dorian 2, ..., aeolian 9, locrian 11.
+ *     rule <name> <from mode> <to mode> <interval>
+ *         Edges from every key in the first mode to the key in the
+ *         second mode whose tonic is interval semitones higher. A mode
+ *         of * stands for every mode, and a to mode of = for the from
+ *         mode itself. An interval of sig picks the tonic with the same
+ *         key signature instead. Several lines may share a rule name.
+ *
+ * Modes must come before the rules that use them. Edges that would
+ * lead back to the same key are dropped, as are repeats of an edge
+ * already given by an earlier rule.
+ *
+ * The edges are stored in compressed sparse row form, each key's
+ * successors sorted and contiguous, with a second copy for the
+ * predecessors, which shortestPath scans on its bottom-up steps and
+ * which let the graph be searched with bidirectionalSearch too.
+ */
+class TonalGraph {
+public:
+    TonalGraph() = default;
+
+    static TonalGraph parse(std::istream& table);
+    static TonalGraph load(const std::string& path);
+    static TonalGraph standard();
+    static TonalGraph modal();
+
+    int size() const;
+    int numModes() const;
+    int numEdges() const;
+    Vector<std::string> ruleNames() const;
+
+    int node(const std::string& key) const;
+    std::string nodeName(int node) const;
+    int edgeRule(int from, int to) const;
+
+    TonalGraph restrictedTo(const Set<std::string>& rules) const;
+
+    Vector<int> shortestPath(int source, int target, long long& expanded) const;
+
+    template <typename F>
+    void forEachSuccessor(int node, F visit) const {
+        for (int edge = offsets[node]; edge < offsets[node + 1]; edge++) {
+            visit(targets[edge]);
+        }
+    }
+
+    template <typename F>
+    void forEachPredecessor(int node, F visit) const {
+        for (int edge = reverseOffsets[node]; edge < reverseOffsets[node + 1]; edge++) {
+            visit(sources[edge]);
+        }
+    }
+
+private:
+    struct Edge {
+        int from;
+        int to;
+        int rule;
+    };
+
+    void build(Vector<Edge>& edges);
+
+    Vector<std::string> modes;
+    Vector<int> degrees;
+    Vector<std::string> rules;
+    std::vector<int> offsets;
+    std::vector<int> targets;
+    std::vector<int> edgeRules;
+    std::vector<int> reverseOffsets;
+    std::vector<int> sources;
+};
+
+Stack<std::string> modulateModal(const TonalGraph& graph, std::string startKey, std::string endKey);